@@ -0,0 +1,402 @@
+/*
+    Copyright 2013 Felix Müller.
+
+    This file is part of VSSim.
+
+    VSSim is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    VSSim is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with VSSim.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "CapacityOptimizer.h"
+#include "Generator.h"
+#include <QtConcurrentMap>
+#include <algorithm>
+#include <math.h>
+
+//Largest number of service units considered, same as in the GUI
+static const unsigned int MAX_SERVICE_UNITS = 500;
+
+//Candidates whose M/M/c value is further than this factor off the target are
+//decided without simulation
+static const double ANALYTIC_MARGIN = 2.0;
+
+//Requests per lane simulated for every racing candidate in one round
+static const size_t BATCH_SIZE = 16384;
+
+//Student t quantile for a 95% confidence interval over the lanes
+static const double STUDENT_T = ( FastPathEngine::LANES == 16 ) ? 2.131 : 2.365;
+
+//Probability of deciding any candidate wrongly outside the indifference zone
+static const double ERROR_PROBABILITY = 0.05;
+
+CapacityOptimizer::CapacityOptimizer( unsigned int incomingRate,
+                                      unsigned int serviceDuration,
+                                      E_TARGET_TYPE type, double target,
+                                      QObject *parent )
+    : QThread( parent ),
+      mIncomingRate( incomingRate ),
+      mServiceDuration( serviceDuration ),
+      mType( type ),
+      mTarget( target ),
+      mQuantile( 0.99 ),
+      mIndifferenceZone( 0.02 ),
+      mRequestBudget( 2000000000 ),
+      mRunning( true )
+{
+}
+
+void CapacityOptimizer::run()
+{
+    //Loads of at least c make the queue grow without bound
+    double load = Generator::truncatedMean( mServiceDuration )
+            / Generator::truncatedMean( mIncomingRate );
+    unsigned int minServiceUnits = (unsigned int)std::floor( load ) + 1;
+
+    //Prune candidates by their distance to the value reached with unlimited
+    //service units: below the first one the model is clearly worse than the
+    //target, beyond the last one clearly better. Targets not above that value
+    //can't be met at all.
+    double limit = analyticValue( 0 );
+    double distance = mTarget - limit;
+    unsigned int first = minServiceUnits;
+    while( first <= MAX_SERVICE_UNITS
+           && ( distance <= 0.0 || analyticValue( first ) - limit > distance * ANALYTIC_MARGIN ) )
+    {
+        ++first;
+    }
+    unsigned int last = first;
+    while( last < MAX_SERVICE_UNITS
+           && analyticValue( last ) - limit > distance / ANALYTIC_MARGIN )
+    {
+        ++last;
+    }
+
+    std::vector<Race> races;
+    for( unsigned int c = first; c <= last && c <= MAX_SERVICE_UNITS; ++c )
+    {
+        Candidate candidate( c );
+        candidate.analytic = analyticValue( c );
+        mResult.candidates.push_back( candidate );
+
+        Race race;
+        race.candidate = mResult.candidates.size() - 1;
+        races.push_back( std::move( race ) );
+    }
+
+    //A single candidate is decided by the bounds alone if the model shows it
+    //clearly meets the target, otherwise it is simulated as well
+    if( mResult.candidates.size() == 1
+            && mResult.candidates[0].analytic - limit <= distance / ANALYTIC_MARGIN )
+    {
+        mResult.candidates[0].state = ECS_FEASIBLE;
+    }
+
+    while( mRunning && !isDecided() && mResult.numRequests < mRequestBudget )
+    {
+        std::vector<Race *> racing;
+        for( Race &race : races )
+        {
+            if( mResult.candidates[race.candidate].state != ECS_RACING )
+            {
+                continue;
+            }
+
+            if( !race.engine )
+            {
+                race.engine.reset( new FastPathEngine(
+                                       mIncomingRate, mServiceDuration,
+                                       mResult.candidates[race.candidate].serviceUnits ) );
+                race.engine->enableHistogram( mType == ETT_QUANTILE_T );
+            }
+            racing.push_back( &race );
+        }
+
+        QtConcurrent::blockingMap( racing, simulateRace );
+
+        for( Race *race : racing )
+        {
+            evaluateRace( *race );
+            mResult.numRequests += BATCH_SIZE * FastPathEngine::LANES;
+        }
+        eliminate();
+
+        emit updateValues( mResult );
+    }
+
+    //Smallest candidate meeting the target, undecided ones by their estimate
+    mResult.decided = isDecided();
+    for( const Candidate &candidate : mResult.candidates )
+    {
+        if( candidate.state == ECS_FEASIBLE
+                || ( candidate.state == ECS_RACING && candidate.value <= mTarget ) )
+        {
+            mResult.serviceUnits = candidate.serviceUnits;
+            break;
+        }
+    }
+
+    mRunning = false;
+    emit updateValues( mResult );
+    emit finished();
+}
+
+bool CapacityOptimizer::isRunning()
+{
+    return mRunning;
+}
+
+void CapacityOptimizer::quit()
+{
+    mRunning = false;
+}
+
+void CapacityOptimizer::setQuantile( double quantile )
+{
+    mQuantile = quantile;
+}
+
+void CapacityOptimizer::setRequestBudget( size_t numRequests )
+{
+    mRequestBudget = numRequests;
+}
+
+void CapacityOptimizer::setIndifferenceZone( double fraction )
+{
+    mIndifferenceZone = fraction;
+}
+
+void CapacityOptimizer::simulateRace( Race *race )
+{
+    race->engine->simulate( BATCH_SIZE );
+}
+
+double CapacityOptimizer::analyticValue( unsigned int serviceUnits ) const
+{
+    double s = Generator::truncatedMean( mServiceDuration );
+    double load = s / Generator::truncatedMean( mIncomingRate );
+    double c = serviceUnits;
+
+    //0 service units stand for an unlimited number, where nobody waits
+    double C = 0.0;
+    if( serviceUnits > 0 )
+    {
+        if( load >= c )
+        {
+            return HUGE_VAL;
+        }
+
+        //Erlang C formula via the Erlang B recursion
+        double B = 1.0;
+        for( unsigned int k = 1; k <= serviceUnits; ++k )
+        {
+            B = load * B / ( k + load * B );
+        }
+        C = c * B / ( c - load * ( 1.0 - B ) );
+    }
+
+    double TQ = ( C > 0.0 ) ? C * s / ( c - load ) : 0.0;
+    if( mType == ETT_MEAN_TQ )
+    {
+        return TQ;
+    }
+    if( mType == ETT_MEAN_T )
+    {
+        return TQ + s;
+    }
+
+    //Bisect the time at which P(T > t) falls below the tail probability
+    double tail = 1.0 - mQuantile;
+    double low = 0.0, high = s;
+    while( tailProbability( C, s, c - load, high ) > tail )
+    {
+        high *= 2.0;
+    }
+    for( int x = 0; x < 100; ++x )
+    {
+        double t = 0.5 * ( low + high );
+        if( tailProbability( C, s, c - load, t ) > tail )
+        {
+            low = t;
+        }
+        else
+        {
+            high = t;
+        }
+    }
+
+    return high;
+}
+
+double CapacityOptimizer::tailProbability( double C, double serviceDuration,
+                                           double idleUnits, double t )
+{
+    //T is the exponential service duration plus, with probability C, an
+    //exponential waiting time with rate idleUnits / serviceDuration
+    double mu = 1.0 / serviceDuration;
+    double theta = idleUnits / serviceDuration;
+    if( C <= 0.0 )
+    {
+        return exp( -mu * t );
+    }
+
+    double wait;
+    if( fabs( theta - mu ) < 1e-12 * mu )
+    {
+        wait = ( 1.0 + mu * t ) * exp( -mu * t );
+    }
+    else
+    {
+        wait = ( theta * exp( -mu * t ) - mu * exp( -theta * t ) ) / ( theta - mu );
+    }
+
+    return ( 1.0 - C ) * exp( -mu * t ) + C * wait;
+}
+
+double CapacityOptimizer::laneTotal( const FastPathEngine &engine, int lane ) const
+{
+    //Quantile targets are compared as the share of requests with T above
+    //the target against the tail probability
+    const FastPathEngine::LaneStatistics &stats = engine.getLaneStatistics( lane );
+    switch( mType )
+    {
+    case ETT_MEAN_T:
+        return (double)stats.sumT;
+    case ETT_MEAN_TQ:
+        return (double)stats.sumTQ;
+    default:
+        return (double)engine.getCountAboveT( lane, mTarget );
+    }
+}
+
+void CapacityOptimizer::evaluateRace( Race &race )
+{
+    Candidate &candidate = mResult.candidates[race.candidate];
+    double standard = ( mType == ETT_QUANTILE_T ) ? 1.0 - mQuantile : mTarget;
+
+    //Every lane is an independent replication, the requests it simulated in
+    //this round give one observation
+    double sum = 0.0, sumSQ = 0.0, batchSum = 0.0, batchSumSQ = 0.0;
+    for( int lane = 0; lane < FastPathEngine::LANES; ++lane )
+    {
+        const FastPathEngine::LaneStatistics &stats = race.engine->getLaneStatistics( lane );
+
+        double total = laneTotal( *race.engine, lane );
+        double batch = ( total - race.lastTotal[lane] ) / (double)( stats.num - race.lastNum[lane] );
+        race.lastTotal[lane] = total;
+        race.lastNum[lane] = stats.num;
+        race.sum += batch - standard;
+        batchSum += batch;
+        batchSumSQ += batch * batch;
+
+        double value = ( mType == ETT_QUANTILE_T )
+                ? (double)race.engine->getQuantileT( lane, mQuantile )
+                : total / (double)stats.num;
+        sum += value;
+        sumSQ += value * value;
+    }
+
+    double n = FastPathEngine::LANES;
+    double variance = std::max( 0.0, ( sumSQ - sum * sum / n ) / ( n - 1.0 ) );
+
+    candidate.value = sum / n;
+    candidate.halfWidth = STUDENT_T * std::sqrt( variance / n );
+    candidate.numRequests = race.engine->getLaneStatistics( 0 ).num * FastPathEngine::LANES;
+
+    if( race.numObservations == 0 )
+    {
+        race.variance = std::max( 0.0, ( batchSumSQ - batchSum * batchSum / n ) / ( n - 1.0 ) );
+    }
+    race.numObservations += FastPathEngine::LANES;
+
+    //Continuation region for comparing one system with a known standard,
+    //the error probability split evenly between the candidates
+    double alpha = ERROR_PROBABILITY / (double)mResult.candidates.size();
+    double eta = 0.5 * ( pow( 2.0 * alpha, -2.0 / ( n - 1.0 ) ) - 1.0 );
+    double h2 = 2.0 * eta * ( n - 1.0 );
+    double delta = mIndifferenceZone * standard;
+    double bound = std::max( 0.0, h2 * race.variance / ( 2.0 * delta )
+                             - delta * (double)race.numObservations / 2.0 );
+
+    //Once the region has closed the sign of the sum decides
+    if( race.sum > bound )
+    {
+        candidate.state = ECS_INFEASIBLE;
+    }
+    else if( race.sum < -bound || bound <= 0.0 )
+    {
+        candidate.state = ECS_FEASIBLE;
+    }
+}
+
+void CapacityOptimizer::eliminate()
+{
+    std::vector<Candidate> &candidates = mResult.candidates;
+
+    //More service units than a feasible candidate are feasible as well, fewer
+    //than an infeasible one infeasible, neither can be the minimum
+    for( size_t x = 0; x < candidates.size(); ++x )
+    {
+        for( size_t y = 0; y < candidates.size(); ++y )
+        {
+            if( candidates[y].state == ECS_RACING
+                    && ( ( candidates[x].state == ECS_FEASIBLE && y > x )
+                         || ( candidates[x].state == ECS_INFEASIBLE && y < x ) ) )
+            {
+                candidates[y].state = ECS_ELIMINATED;
+            }
+        }
+    }
+}
+
+bool CapacityOptimizer::isDecided() const
+{
+    for( const Candidate &candidate : mResult.candidates )
+    {
+        if( candidate.state == ECS_RACING )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+CapacityOptimizer::Candidate::Candidate( unsigned int serviceUnits )
+    : serviceUnits( serviceUnits ),
+      state( ECS_RACING ),
+      analytic( 0.0 ),
+      value( 0.0 ),
+      halfWidth( 0.0 ),
+      numRequests( 0 )
+{
+}
+
+CapacityOptimizer::Race::Race()
+    : candidate( 0 ),
+      numObservations( 0 ),
+      sum( 0.0 ),
+      variance( 0.0 )
+{
+    for( int lane = 0; lane < FastPathEngine::LANES; ++lane )
+    {
+        lastTotal[lane] = 0.0;
+        lastNum[lane] = 0;
+    }
+}
+
+CapacityOptimizer::Result::Result()
+    : serviceUnits( 0 ),
+      decided( false ),
+      numRequests( 0 )
+{
+}
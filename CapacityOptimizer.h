@@ -0,0 +1,135 @@
+/*
+    Copyright 2013 Felix Müller.
+
+    This file is part of VSSim.
+
+    VSSim is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    VSSim is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with VSSim.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CAPACITYOPTIMIZER_H
+#define CAPACITYOPTIMIZER_H
+
+#include <QThread>
+#include <vector>
+#include <memory>
+#include "FastPathEngine.h"
+
+//Searches the minimal number of service units meeting a target for T or TQ.
+//Candidates far from the target are pruned with the M/M/c formulas, the
+//remaining ones are simulated in parallel on the fast path engine, whose
+//lanes serve as independent replications. Every candidate is compared to the
+//target with a fully sequential indifference-zone procedure (Kim-Nelson):
+//the summed differences of the batch values to the target are checked against
+//a triangular continuation region, so the error probability holds no matter
+//how many rounds are needed. Since more service units never make things
+//worse, deciding a candidate decides its neighbours too.
+class CapacityOptimizer : public QThread
+{
+    Q_OBJECT
+public:
+    enum E_TARGET_TYPE
+    {
+        ETT_MEAN_T = 0,
+        ETT_MEAN_TQ,
+        ETT_QUANTILE_T
+    };
+
+    enum E_CANDIDATE_STATE
+    {
+        ECS_RACING = 0,
+        ECS_FEASIBLE,
+        ECS_INFEASIBLE,
+        ECS_ELIMINATED
+    };
+
+    struct Candidate
+    {
+        Candidate( unsigned int serviceUnits = 0 );
+        unsigned int serviceUnits;
+        E_CANDIDATE_STATE state;
+
+        //Value of the M/M/c model and the simulated estimate with the half
+        //width of its 95% confidence interval, for display only
+        double analytic, value, halfWidth;
+        size_t numRequests;
+    };
+
+    struct Result
+    {
+        Result();
+
+        //Minimal number of service units meeting the target, 0 if none does
+        unsigned int serviceUnits;
+
+        //False if the request budget ran out before the candidates next to
+        //the result were decided
+        bool decided;
+
+        size_t numRequests;
+        std::vector<Candidate> candidates;
+    };
+
+    explicit CapacityOptimizer( unsigned int incomingRate, unsigned int serviceDuration,
+                                E_TARGET_TYPE type, double target, QObject *parent = 0 );
+
+    void run();
+
+    bool isRunning();
+    void quit();
+    void setQuantile( double quantile );
+    void setRequestBudget( size_t numRequests );
+    void setIndifferenceZone( double fraction );
+
+signals:
+    void finished();
+    void updateValues( const CapacityOptimizer::Result &result );
+
+private:
+    struct Race
+    {
+        Race();
+        size_t candidate;
+        std::unique_ptr<FastPathEngine> engine;
+
+        //Batch values so far, the sum of their differences to the target and
+        //the variance of the first batch, which sets the continuation region
+        size_t numObservations;
+        double sum, variance;
+
+        //Cumulative totals per lane at the end of the previous round
+        double lastTotal[FastPathEngine::LANES];
+        size_t lastNum[FastPathEngine::LANES];
+    };
+
+    static void simulateRace( Race *race );
+
+    double analyticValue( unsigned int serviceUnits ) const;
+    static double tailProbability( double C, double serviceDuration,
+                                   double idleUnits, double t );
+    double laneTotal( const FastPathEngine &engine, int lane ) const;
+    void evaluateRace( Race &race );
+    void eliminate();
+    bool isDecided() const;
+
+    unsigned int mIncomingRate, mServiceDuration;
+    E_TARGET_TYPE mType;
+    double mTarget, mQuantile, mIndifferenceZone;
+    size_t mRequestBudget;
+
+    bool mRunning;
+
+    Result mResult;
+};
+
+#endif // CAPACITYOPTIMIZER_H
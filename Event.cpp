@@ -19,10 +19,16 @@
 
 #include "Event.h"
 
-Event::Event( E_EVENT_TYPE type, size_t startTime, size_t creationTime )
+Event::Event( E_EVENT_TYPE type, size_t startTime, size_t creationTime,
+              unsigned int segment )
     : mType( type ),
       mStartTime( startTime ),
-      mCreationTime( creationTime )
+      mCreationTime( creationTime ),
+      mSegment( segment ),
+      mServiceUnit( -1 ),
+      mGeneration( 0 ),
+      mFlags( 0 ),
+      mArrivalDerivative( 0.0 )
 {
 }
 
@@ -46,9 +52,51 @@ size_t Event::getCreationTime() const
     return mCreationTime;
 }
 
+unsigned int Event::getSegment() const
+{
+    return mSegment;
+}
+
+void Event::setServiceUnit( int serviceUnit, unsigned int generation )
+{
+    mServiceUnit = serviceUnit;
+    mGeneration = generation;
+}
+
+int Event::getServiceUnit() const
+{
+    return mServiceUnit;
+}
+
+unsigned int Event::getGeneration() const
+{
+    return mGeneration;
+}
+
+void Event::setFlags( unsigned int flags )
+{
+    mFlags = flags;
+}
+
+unsigned int Event::getFlags() const
+{
+    return mFlags;
+}
+
+void Event::setArrivalDerivative( double derivative )
+{
+    mArrivalDerivative = derivative;
+}
+
+double Event::getArrivalDerivative() const
+{
+    return mArrivalDerivative;
+}
+
 std::pair<size_t, Event> Event::makeEventPair( Event::E_EVENT_TYPE type,
                                                size_t startTime,
-                                               size_t creationTime )
+                                               size_t creationTime,
+                                               unsigned int segment )
 {
-    return std::make_pair( startTime, Event( type, startTime, creationTime ) );
+    return std::make_pair( startTime, Event( type, startTime, creationTime, segment ) );
 }
@@ -31,23 +31,55 @@ public:
         EET_INCOMING_EVENT = 0,
         EET_FINISHED_EVENT,
         EET_START_SERVICE_EVENT,
-        EET_MEASURE_EVENT
+        EET_MEASURE_EVENT,
+        EET_FAILURE_EVENT,
+        EET_REPAIR_EVENT
     };
 
-    Event( E_EVENT_TYPE type, size_t startTime, size_t creationTime );
+    enum E_EVENT_FLAG
+    {
+        EEF_DEGRADED = 1,   //Request arrived while service units were down
+        EEF_REQUEUED = 2    //Request was put back into the queue by a breakdown
+    };
+
+    Event( E_EVENT_TYPE type, size_t startTime, size_t creationTime,
+           unsigned int segment = 0 );
 
     E_EVENT_TYPE getType() const;
     void setStartTime( size_t startTime );
     size_t getStartTime() const;
     size_t getCreationTime() const;
+    unsigned int getSegment() const;
+    void setServiceUnit( int serviceUnit, unsigned int generation );
+    int getServiceUnit() const;
+    unsigned int getGeneration() const;
+    void setFlags( unsigned int flags );
+    unsigned int getFlags() const;
+    void setArrivalDerivative( double derivative );
+    double getArrivalDerivative() const;
 
     static std::pair<size_t, Event> makeEventPair( E_EVENT_TYPE type,
                                                           size_t startTime,
-                                                          size_t creationTime );
+                                                          size_t creationTime,
+                                                          unsigned int segment = 0 );
 
 private:
     E_EVENT_TYPE mType;
     size_t mStartTime, mCreationTime;
+
+    //Rate profile segment the request arrived in
+    unsigned int mSegment;
+
+    //Service unit handling the event (-1 for none) and the unit's generation
+    //when the event was scheduled
+    int mServiceUnit;
+    unsigned int mGeneration;
+
+    unsigned int mFlags;
+
+    //Derivative of the request's arrival time with respect to the arrival
+    //rate, for perturbation analysis
+    double mArrivalDerivative;
 };
 
 #endif // EVENT_H
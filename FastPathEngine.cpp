@@ -0,0 +1,245 @@
+/*
+    Copyright 2013 Felix Müller.
+
+    This file is part of VSSim.
+
+    VSSim is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    VSSim is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with VSSim.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "FastPathEngine.h"
+#include <algorithm>
+
+#if defined( __AVX512F__ ) || defined( __AVX2__ )
+#include <immintrin.h>
+#endif
+
+//Number of requests per lane generated and processed at once
+static const size_t BLOCK_SIZE = 1024;
+
+FastPathEngine::FastPathEngine( unsigned int incomingRate,
+                                unsigned int serviceDuration,
+                                unsigned int serviceUnits )
+    : mNumServiceUnits( std::max( serviceUnits, 1u ) ),
+      mIncomingRateGenerators( LANES ),
+      mServiceDurationGenerators( LANES ),
+      mWorkload( mNumServiceUnits * LANES, 0 ),
+      mIncomingDistances( BLOCK_SIZE * LANES ),
+      mServiceDurations( BLOCK_SIZE * LANES ),
+      mWaitingTimes( BLOCK_SIZE * LANES ),
+      mHistogramEnabled( false )
+{
+    for( int lane = 0; lane < LANES; ++lane )
+    {
+        mIncomingRateGenerators[lane].setValue( incomingRate );
+        mServiceDurationGenerators[lane].setValue( serviceDuration );
+    }
+}
+
+void FastPathEngine::simulate( size_t numRequests )
+{
+    while( numRequests > 0 )
+    {
+        size_t blockSize = std::min( numRequests, BLOCK_SIZE );
+
+        generateBlock( blockSize );
+        processBlock( blockSize );
+
+        //Accumulate statistics of the block
+        for( size_t x = 0; x < blockSize; ++x )
+        {
+            for( int lane = 0; lane < LANES; ++lane )
+            {
+                size_t i = x * LANES + lane;
+                uint64_t TQ = mWaitingTimes[i];
+                uint64_t T = TQ + mServiceDurations[i];
+
+                LaneStatistics &stats = mLanes[lane];
+                stats.sumT += T;
+                stats.sumSQT += T * T;
+                stats.sumTQ += TQ;
+                stats.sumSQTQ += TQ * TQ;
+                stats.time += mIncomingDistances[i];
+
+                if( mHistogramEnabled )
+                {
+                    std::vector<size_t> &histogram = mHistograms[lane];
+                    if( histogram.size() <= T )
+                    {
+                        histogram.resize( T + 1, 0 );
+                    }
+                    histogram[T]++;
+                }
+            }
+        }
+
+        for( int lane = 0; lane < LANES; ++lane )
+        {
+            mLanes[lane].num += blockSize;
+        }
+
+        numRequests -= blockSize;
+    }
+}
+
+const FastPathEngine::LaneStatistics &FastPathEngine::getLaneStatistics( int lane ) const
+{
+    return mLanes[lane];
+}
+
+void FastPathEngine::enableHistogram( bool enabled )
+{
+    mHistogramEnabled = enabled;
+}
+
+size_t FastPathEngine::getQuantileT( int lane, double quantile ) const
+{
+    const std::vector<size_t> &histogram = mHistograms[lane];
+    double count = quantile * (double)mLanes[lane].num;
+
+    size_t sum = 0;
+    for( size_t T = 0; T < histogram.size(); ++T )
+    {
+        sum += histogram[T];
+        if( (double)sum >= count )
+        {
+            return T;
+        }
+    }
+
+    return histogram.size();
+}
+
+size_t FastPathEngine::getCountAboveT( int lane, double T ) const
+{
+    const std::vector<size_t> &histogram = mHistograms[lane];
+
+    size_t count = 0;
+    for( size_t x = histogram.size(); x > 0 && (double)( x - 1 ) > T; --x )
+    {
+        count += histogram[x - 1];
+    }
+
+    return count;
+}
+
+void FastPathEngine::generateBlock( size_t numRequests )
+{
+    for( int lane = 0; lane < LANES; ++lane )
+    {
+        for( size_t x = 0; x < numRequests; ++x )
+        {
+            mIncomingDistances[x * LANES + lane] = mIncomingRateGenerators[lane].generate();
+            mServiceDurations[x * LANES + lane] = mServiceDurationGenerators[lane].generate();
+        }
+    }
+}
+
+void FastPathEngine::processBlock( size_t numRequests )
+{
+    uint32_t *W = mWorkload.data();
+    unsigned int c = mNumServiceUnits;
+
+    for( size_t x = 0; x < numRequests; ++x )
+    {
+        const uint32_t *A = &mIncomingDistances[x * LANES];
+        const uint32_t *S = &mServiceDurations[x * LANES];
+        uint32_t *TQ = &mWaitingTimes[x * LANES];
+
+        //The request waits for the least loaded unit, gets its service
+        //duration added to that unit, then all units work off the time until
+        //the next request arrives: W = max( W + S * e(min) - A, 0 )
+#if defined( __AVX512F__ )
+        __m512i minW = _mm512_loadu_si512( W );
+        __m512i minIndex = _mm512_setzero_si512();
+        for( unsigned int k = 1; k < c; ++k )
+        {
+            __m512i w = _mm512_loadu_si512( W + k * LANES );
+            __mmask16 less = _mm512_cmplt_epu32_mask( w, minW );
+            minW = _mm512_min_epu32( w, minW );
+            minIndex = _mm512_mask_mov_epi32( minIndex, less, _mm512_set1_epi32( k ) );
+        }
+        _mm512_storeu_si512( TQ, minW );
+
+        __m512i a = _mm512_loadu_si512( A );
+        __m512i s = _mm512_loadu_si512( S );
+        for( unsigned int k = 0; k < c; ++k )
+        {
+            __m512i w = _mm512_loadu_si512( W + k * LANES );
+            __mmask16 assigned = _mm512_cmpeq_epi32_mask( minIndex, _mm512_set1_epi32( k ) );
+            w = _mm512_mask_add_epi32( w, assigned, w, s );
+            w = _mm512_sub_epi32( _mm512_max_epu32( w, a ), a );
+            _mm512_storeu_si512( W + k * LANES, w );
+        }
+#elif defined( __AVX2__ )
+        __m256i minW = _mm256_loadu_si256( (const __m256i *)W );
+        __m256i minIndex = _mm256_setzero_si256();
+        for( unsigned int k = 1; k < c; ++k )
+        {
+            __m256i w = _mm256_loadu_si256( (const __m256i *)( W + k * LANES ) );
+            __m256i newMinW = _mm256_min_epu32( w, minW );
+            __m256i notLess = _mm256_cmpeq_epi32( newMinW, minW );
+            minIndex = _mm256_blendv_epi8( _mm256_set1_epi32( k ), minIndex, notLess );
+            minW = newMinW;
+        }
+        _mm256_storeu_si256( (__m256i *)TQ, minW );
+
+        __m256i a = _mm256_loadu_si256( (const __m256i *)A );
+        __m256i s = _mm256_loadu_si256( (const __m256i *)S );
+        for( unsigned int k = 0; k < c; ++k )
+        {
+            __m256i w = _mm256_loadu_si256( (const __m256i *)( W + k * LANES ) );
+            __m256i assigned = _mm256_cmpeq_epi32( minIndex, _mm256_set1_epi32( k ) );
+            w = _mm256_add_epi32( w, _mm256_and_si256( assigned, s ) );
+            w = _mm256_sub_epi32( _mm256_max_epu32( w, a ), a );
+            _mm256_storeu_si256( (__m256i *)( W + k * LANES ), w );
+        }
+#else
+        uint32_t minIndex[LANES];
+        for( int lane = 0; lane < LANES; ++lane )
+        {
+            TQ[lane] = W[lane];
+            minIndex[lane] = 0;
+        }
+        for( unsigned int k = 1; k < c; ++k )
+        {
+            for( int lane = 0; lane < LANES; ++lane )
+            {
+                uint32_t w = W[k * LANES + lane];
+                minIndex[lane] = ( w < TQ[lane] ) ? k : minIndex[lane];
+                TQ[lane] = std::min( w, TQ[lane] );
+            }
+        }
+
+        for( unsigned int k = 0; k < c; ++k )
+        {
+            for( int lane = 0; lane < LANES; ++lane )
+            {
+                uint32_t w = W[k * LANES + lane]
+                        + ( ( minIndex[lane] == k ) ? S[lane] : 0 );
+                W[k * LANES + lane] = std::max( w, A[lane] ) - A[lane];
+            }
+        }
+#endif
+    }
+}
+
+FastPathEngine::LaneStatistics::LaneStatistics()
+    : num( 0 ),
+      time( 0 ),
+      sumT( 0 ),
+      sumSQT( 0 ),
+      sumTQ( 0 ),
+      sumSQTQ( 0 )
+{
+}
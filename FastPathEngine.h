@@ -0,0 +1,81 @@
+/*
+    Copyright 2013 Felix Müller.
+
+    This file is part of VSSim.
+
+    VSSim is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    VSSim is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with VSSim.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef FASTPATHENGINE_H
+#define FASTPATHENGINE_H
+
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+#include "Generator.h"
+
+//Simulates a FIFO station with c service units without an event list: the
+//waiting time of each request follows the Kiefer-Wolfowitz recursion over the
+//workload vector of the service units (the Lindley recursion for c = 1).
+//Independent replications run side by side in SIMD lanes.
+class FastPathEngine
+{
+public:
+#if defined( __AVX512F__ )
+    static const int LANES = 16;
+#else
+    static const int LANES = 8;
+#endif
+
+    struct LaneStatistics
+    {
+        LaneStatistics();
+        size_t num, time;
+        uint64_t sumT, sumSQT, sumTQ, sumSQTQ;
+    };
+
+    FastPathEngine( unsigned int incomingRate, unsigned int serviceDuration,
+                    unsigned int serviceUnits );
+
+    //Simulate the given number of requests in every lane
+    void simulate( size_t numRequests );
+
+    const LaneStatistics &getLaneStatistics( int lane ) const;
+
+    //Collect the distribution of T per lane, needed for quantiles
+    void enableHistogram( bool enabled );
+    size_t getQuantileT( int lane, double quantile ) const;
+    size_t getCountAboveT( int lane, double T ) const;
+
+private:
+    void generateBlock( size_t numRequests );
+    void processBlock( size_t numRequests );
+
+    unsigned int mNumServiceUnits;
+
+    std::vector<Generator> mIncomingRateGenerators, mServiceDurationGenerators;
+
+    //Remaining work of every service unit, stored as [unit][lane]
+    std::vector<uint32_t> mWorkload;
+
+    //Pre-generated samples and per-request results, stored as [request][lane]
+    std::vector<uint32_t> mIncomingDistances, mServiceDurations, mWaitingTimes;
+
+    LaneStatistics mLanes[LANES];
+
+    bool mHistogramEnabled;
+    std::vector<size_t> mHistograms[LANES];
+};
+
+#endif // FASTPATHENGINE_H
@@ -18,11 +18,25 @@
 */
 
 #include "Generator.h"
+#include <QAtomicInt>
 #include <time.h>
+#include <math.h>
 
 Generator::Generator()
+    : mType( EDT_EXPONENTIAL ),
+      mValue( 1 ),
+      mLastSample( 0.0 )
 {
-    mRandomNumberGenerator.seed( std::time( 0 ) );
+    //Generators created at the same time must not share a random sequence,
+    //the optimizer creates them in a thread of its own
+    static QAtomicInt instanceCount( 0 );
+    unsigned int instance = instanceCount.fetchAndAddOrdered( 1 );
+    mRandomNumberGenerator.seed( std::time( 0 ) + 7919 * instance );
+}
+
+void Generator::setDistribution( E_DISTRIBUTION_TYPE type )
+{
+    mType = type;
 }
 
 void Generator::setValue( unsigned int value )
@@ -30,9 +44,60 @@ void Generator::setValue( unsigned int value )
     mValue = value;
     mDistribution.param(
                 boost::random::exponential_distribution<double>::param_type( 1.0 / (double)mValue ) );
+    mUniformDistribution.param(
+                boost::random::uniform_real_distribution<double>::param_type( 0.0, 2.0 * mValue ) );
+}
+
+unsigned int Generator::getValue() const
+{
+    return mValue;
+}
+
+double Generator::getMean() const
+{
+    switch( mType )
+    {
+    case EDT_DETERMINISTIC:
+        return mValue;
+    case EDT_UNIFORM:
+        return (double)mValue - 0.5;
+    default:
+        return truncatedMean( mValue );
+    }
+}
+
+double Generator::truncatedMean( unsigned int value )
+{
+    //Mean of an exponential sample with the given mean cut down to whole units
+    return 1.0 / ( exp( 1.0 / (double)value ) - 1.0 );
 }
 
 unsigned int Generator::generate()
 {
-    return mDistribution( mRandomNumberGenerator );
+    switch( mType )
+    {
+    case EDT_DETERMINISTIC:
+        mLastSample = mValue;
+        break;
+    case EDT_UNIFORM:
+        mLastSample = mUniformDistribution( mRandomNumberGenerator );
+        break;
+    default:
+        mLastSample = mDistribution( mRandomNumberGenerator );
+        break;
+    }
+
+    return mLastSample;
+}
+
+double Generator::getLastSample() const
+{
+    return mLastSample;
+}
+
+size_t Generator::generateIndex( const std::vector<double> &weights )
+{
+    boost::random::discrete_distribution<size_t> distribution( weights.begin(),
+                                                               weights.end() );
+    return distribution( mRandomNumberGenerator );
 }
@@ -22,18 +22,43 @@
 
 #include <boost/random.hpp>
 #include <boost/random/exponential_distribution.hpp>
+#include <boost/random/discrete_distribution.hpp>
+#include <boost/random/uniform_real_distribution.hpp>
+#include <vector>
 
 class Generator
 {
 public:
+    enum E_DISTRIBUTION_TYPE
+    {
+        EDT_EXPONENTIAL = 0,
+        EDT_DETERMINISTIC,
+        EDT_UNIFORM         //Uniform between 0 and twice the value
+    };
+
     Generator();
 
+    void setDistribution( E_DISTRIBUTION_TYPE type );
     void setValue( unsigned int value );
+    unsigned int getValue() const;
+
+    //Mean of the generated samples, which are cut down to whole time units
+    double getMean() const;
+    static double truncatedMean( unsigned int value );
     unsigned int generate();
 
+    //Untruncated value of the last generated sample
+    double getLastSample() const;
+
+    //Draw an index with probability proportional to its weight
+    size_t generateIndex( const std::vector<double> &weights );
+
 protected:
+    E_DISTRIBUTION_TYPE mType;
     unsigned int mValue;
+    double mLastSample;
     boost::random::exponential_distribution<double> mDistribution;
+    boost::random::uniform_real_distribution<double> mUniformDistribution;
     boost::random::mt11213b mRandomNumberGenerator;
 };
 
@@ -20,6 +20,7 @@
 #include "MainWindow.h"
 #include "ui_MainWindow.h"
 #include <QMessageBox>
+#include <QFileDialog>
 #include <iostream>
 
 MainWindow::MainWindow(QWidget *parent) :
@@ -28,6 +29,7 @@ MainWindow::MainWindow(QWidget *parent) :
 {
     ui->setupUi(this);
     qRegisterMetaType<Simulator::SimulationData>( "Simulator::SimulationData" );
+    qRegisterMetaType<CapacityOptimizer::Result>( "CapacityOptimizer::Result" );
 
     mTimer.setInterval( 100 );
 }
@@ -39,6 +41,10 @@ MainWindow::~MainWindow()
     {
         on_Simulator_finished();
     }
+    if( mOptimizer )
+    {
+        on_CapacityOptimizer_finished();
+    }
 }
 
 void MainWindow::on_startSimulationButton_clicked()
@@ -52,7 +58,26 @@ void MainWindow::on_startSimulationButton_clicked()
 
     float precision = std::pow( 10.f, -( ui->precision->text().toInt() ) );
 
-    if( incomingDistance <= 0 || serviceDistance <= 0 )
+    bool steadyStateStart = ui->steadyStateStart->isChecked();
+    bool enableFastPath = ui->enableFastPath->isChecked();
+    bool enableGradients = ui->enableGradients->isChecked();
+    QString rateProfile = ui->rateProfile->text();
+
+    bool enableBreakdowns = ui->enableBreakdowns->isChecked();
+    unsigned int failureDistance = ui->failureDistance->text().toInt();
+    unsigned int repairDuration = ui->repairDuration->text().toInt();
+
+    unsigned int capacity = ui->capacity->text().toUInt();
+    size_t memoryBudget = (size_t)ui->memoryBudget->text().toUInt() << 20;
+    bool enableOverloadDetection = ui->enableOverloadDetection->isChecked();
+
+    QString settings = QString( "%1/%2/%3/%4/%5/%6/%7/%8" ).arg( numServiceUnits )
+            .arg( incomingDistance ).arg( serviceDistance ).arg( rateProfile )
+            .arg( enableBreakdowns ).arg( failureDistance ).arg( repairDuration )
+            .arg( capacity );
+
+    if( incomingDistance <= 0 || serviceDistance <= 0
+            || ( enableBreakdowns && ( failureDistance <= 0 || repairDuration <= 0 ) ) )
     {
         QMessageBox *msg = new QMessageBox( this );
         msg->setText( tr( "Invalid values entered!" ) );
@@ -65,12 +90,40 @@ void MainWindow::on_startSimulationButton_clicked()
     if( !mSimulator )
     {
         mSimulator.reset( new Simulator( incomingDistance, serviceDistance, numServiceUnits, this ) );
+        if( !mSimulator->loadRateProfile( rateProfile.toLocal8Bit().constData() ) )
+        {
+            mSimulator.reset();
+            ui->startSimulationButton->setText( tr( "Start Simulation" ) );
+
+            QMessageBox *msg = new QMessageBox( this );
+            msg->setText( tr( "Invalid arrival rate profile!" ) );
+            msg->show();
+            return;
+        }
         connect( mSimulator.data(), SIGNAL( finished() ), this,  SLOT( on_Simulator_finished() ) );
         connect( mSimulator.data(), SIGNAL( updateValues(Simulator::SimulationData) ),
                  this, SLOT( on_Simulator_updateValues(Simulator::SimulationData) ) );
         connect( &mTimer, SIGNAL( timeout() ), mSimulator.data(), SLOT( emitUpdateSignal() ) );
         mSimulator->configureMeasureEvents( enableMeasureEvents, measureEventDistance );
         mSimulator->setPrecision( precision );
+        mSimulator->configureFastPath( enableFastPath );
+        mSimulator->configureGradients( enableGradients );
+        mSimulator->configureBreakdowns(
+                    enableBreakdowns,
+                    failureDistance,
+                    (Generator::E_DISTRIBUTION_TYPE)ui->failureDistribution->currentIndex(),
+                    repairDuration,
+                    (Generator::E_DISTRIBUTION_TYPE)ui->repairDistribution->currentIndex(),
+                    (Simulator::E_INTERRUPT_POLICY)ui->interruptPolicy->currentIndex() );
+        mSimulator->configureSteadyStateStart( steadyStateStart );
+        mSimulator->configureCapacity( capacity );
+        mSimulator->configureMemoryBudget( memoryBudget );
+        mSimulator->configureOverloadDetection( enableOverloadDetection );
+        if( steadyStateStart && settings == mEstimatedSettings )
+        {
+            mSimulator->setInitialDistribution( mEstimatedDistribution );
+        }
+        mRunningSettings = settings;
         mSimulator->start();
         mTimer.start();
     }
@@ -81,6 +134,9 @@ void MainWindow::on_startSimulationButton_clicked()
 
     //Calculate theoretical results
     if( numServiceUnits == 1
+            && rateProfile.isEmpty()
+            && !enableBreakdowns
+            && capacity == 0
             && mSimulator )
     {
 
@@ -106,6 +162,15 @@ void MainWindow::on_startSimulationButton_clicked()
     }
 }
 
+void MainWindow::on_rateProfileButton_clicked()
+{
+    QString fileName = QFileDialog::getOpenFileName( this, tr( "Open arrival rate profile" ) );
+    if( !fileName.isEmpty() )
+    {
+        ui->rateProfile->setText( fileName );
+    }
+}
+
 void MainWindow::on_Simulator_finished()
 {
     if( mSimulator )
@@ -130,6 +195,22 @@ void MainWindow::on_Simulator_finished()
 void MainWindow::on_Simulator_updateValues( const Simulator::SimulationData &data )
 {
     ui->simTime->setText( QString::number( data.simulationTime ) );
+    switch( data.stopReason )
+    {
+    case Simulator::ESR_OVERLOAD:
+        ui->statusBar->showMessage( tr( "Stopped: the system is overloaded" ) );
+        break;
+    case Simulator::ESR_MEMORY_BUDGET:
+        ui->statusBar->showMessage( tr( "Stopped: memory budget exhausted" ) );
+        break;
+    case Simulator::ESR_END_OF_PROFILE:
+        ui->statusBar->showMessage( tr( "Stopped: the arrival rate profile ended" ) );
+        break;
+    default:
+        ui->statusBar->showMessage( data.usedFastPath ? tr( "Fast path engine" )
+                                                      : tr( "Event engine" ) );
+        break;
+    }
 
     ui->valueN->setText( QString::number( data.N.value ) );
     ui->valueT->setText( QString::number( data.T.value ) );
@@ -160,4 +241,151 @@ void MainWindow::on_Simulator_updateValues( const Simulator::SimulationData &dat
     ui->tqCheck->setChecked( data.TQ.standardDerivation < data.minimalSD );
 
     ui->checkBox->setChecked( mSimulator ? !mSimulator->isRunning() : false );
+
+    mEstimatedDistribution.assign( data.occupancy.begin(), data.occupancy.end() );
+    mEstimatedSettings = mRunningSettings;
+
+    QString report;
+
+    if( data.stopReason == Simulator::ESR_OVERLOAD )
+    {
+        report += tr( "Unstable: the queue grows by %1 requests per time unit, "
+                      "the results will not converge\n" ).arg( data.queueGrowth );
+    }
+    else if( data.stopReason == Simulator::ESR_MEMORY_BUDGET )
+    {
+        report += tr( "Stopped after queue and events took %1 MB\n" )
+                .arg( data.memoryUsage >> 20 );
+    }
+
+    if( data.capacity > 0 )
+    {
+        report += tr( "Loss probability = %1 (%2 of %3 requests lost)\n" )
+                .arg( data.lossProbability )
+                .arg( data.blocked )
+                .arg( data.arrivals );
+    }
+
+    if( data.enableBreakdowns )
+    {
+        report += tr( "Availability = %1\nT while degraded = %2 (%3 requests)\n" )
+                .arg( data.availability )
+                .arg( data.TDegraded.value )
+                .arg( data.TDegraded.num );
+    }
+
+    if( data.enableGradients )
+    {
+        report += tr( "dT/d(service duration) = %1 +- %2\n" )
+                .arg( data.dTdService.value ).arg( data.dTdService.halfWidth );
+        report += tr( "dTQ/d(service duration) = %1 +- %2\n" )
+                .arg( data.dTQdService.value ).arg( data.dTQdService.halfWidth );
+        report += tr( "dT/d(arrival rate) = %1 +- %2\n" )
+                .arg( data.dTdRate.value ).arg( data.dTdRate.halfWidth );
+    }
+
+    //Results per arrival rate segment
+    for( size_t x = 0; x < data.segments.size(); ++x )
+    {
+        const Simulator::SimulationData::SegmentStatistics &segment = data.segments[x];
+        report += tr( "Segment %1: rate = %2, T = %3, TQ = %4, requests = %5\n" )
+                .arg( x )
+                .arg( segment.time > 0.0 ? segment.requests / segment.time : 0.0 )
+                .arg( segment.T.value )
+                .arg( segment.TQ.value )
+                .arg( segment.requests );
+    }
+    ui->report->setPlainText( report );
+}
+
+void MainWindow::on_optimizeButton_clicked()
+{
+    if( mOptimizer )
+    {
+        on_CapacityOptimizer_finished();
+        return;
+    }
+
+    unsigned int incomingDistance = ui->incomingRate->text().toInt();
+    unsigned int serviceDistance = ui->serviceRate->text().toInt();
+    double target = ui->targetValue->text().toDouble();
+
+    if( incomingDistance <= 0 || serviceDistance <= 0 || target <= 0.0 )
+    {
+        QMessageBox *msg = new QMessageBox( this );
+        msg->setText( tr( "Invalid values entered!" ) );
+        msg->show();
+        return;
+    }
+
+    ui->optimizeButton->setText( tr( "Stop search" ) );
+
+    mOptimizer.reset( new CapacityOptimizer(
+                          incomingDistance, serviceDistance,
+                          (CapacityOptimizer::E_TARGET_TYPE)ui->targetType->currentIndex(),
+                          target, this ) );
+    connect( mOptimizer.data(), SIGNAL( finished() ), this, SLOT( on_CapacityOptimizer_finished() ) );
+    connect( mOptimizer.data(), SIGNAL( updateValues(CapacityOptimizer::Result) ),
+             this, SLOT( on_CapacityOptimizer_updateValues(CapacityOptimizer::Result) ) );
+    mOptimizer->start();
+}
+
+void MainWindow::on_CapacityOptimizer_finished()
+{
+    if( mOptimizer )
+    {
+        mOptimizer->quit();
+        mOptimizer->wait();
+        mOptimizer.reset();
+    }
+    ui->optimizeButton->setText( tr( "Find minimal service units" ) );
+}
+
+void MainWindow::on_CapacityOptimizer_updateValues( const CapacityOptimizer::Result &result )
+{
+    QString report;
+
+    if( result.candidates.empty() )
+    {
+        report += tr( "No number of service units meets the target\n" );
+    }
+    else if( result.serviceUnits > 0 )
+    {
+        report += tr( "Minimal number of service units = %1%2\n" )
+                .arg( result.serviceUnits )
+                .arg( result.decided ? QString() : tr( " (not decided within the budget)" ) );
+        ui->serviceUnitsCount->setValue( result.serviceUnits );
+    }
+    report += tr( "Simulated requests = %1\n" ).arg( result.numRequests );
+
+    for( size_t x = 0; x < result.candidates.size(); ++x )
+    {
+        const CapacityOptimizer::Candidate &candidate = result.candidates[x];
+
+        QString state;
+        switch( candidate.state )
+        {
+        case CapacityOptimizer::ECS_RACING:
+            state = tr( "racing" );
+            break;
+        case CapacityOptimizer::ECS_FEASIBLE:
+            state = tr( "meets target" );
+            break;
+        case CapacityOptimizer::ECS_INFEASIBLE:
+            state = tr( "misses target" );
+            break;
+        default:
+            state = tr( "eliminated" );
+            break;
+        }
+
+        report += tr( "%1 units: model = %2, simulated = %3 +- %4 (%5 requests), %6\n" )
+                .arg( candidate.serviceUnits )
+                .arg( candidate.analytic )
+                .arg( candidate.value )
+                .arg( candidate.halfWidth )
+                .arg( candidate.numRequests )
+                .arg( state );
+    }
+    ui->report->setPlainText( report );
 }
@@ -26,6 +26,7 @@
 #include <QScopedPointer>
 #include <QTimer>
 #include "Simulator.h"
+#include "CapacityOptimizer.h"
 
 namespace Ui {
 class MainWindow;
@@ -41,15 +42,25 @@ public:
 
 private slots:
     void on_startSimulationButton_clicked();
+    void on_rateProfileButton_clicked();
     void on_Simulator_finished();
     void on_Simulator_updateValues( const Simulator::SimulationData &data );
+    void on_optimizeButton_clicked();
+    void on_CapacityOptimizer_finished();
+    void on_CapacityOptimizer_updateValues( const CapacityOptimizer::Result &result );
 
 private:
     Ui::MainWindow *ui;
 
     QScopedPointer<Simulator> mSimulator;
+    QScopedPointer<CapacityOptimizer> mOptimizer;
 
     QTimer mTimer;
+
+    //Occupancy estimated by the last run, used as start distribution when the
+    //same settings are simulated again
+    std::vector<double> mEstimatedDistribution;
+    QString mEstimatedSettings, mRunningSettings;
 };
 
 #endif // MAINWINDOW_H
@@ -0,0 +1,335 @@
+/*
+    Copyright 2013 Felix Müller.
+
+    This file is part of VSSim.
+
+    VSSim is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    VSSim is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with VSSim.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "RateProfile.h"
+#include <fstream>
+#include <sstream>
+#include <limits>
+#include <algorithm>
+#include <math.h>
+
+RateProfile::RateProfile()
+    : mType( EPT_PIECEWISE_CONSTANT ),
+      mPeriod( 0.0 ),
+      mStarted( false ),
+      mTime( 0.0 ),
+      mCycleStart( 0.0 ),
+      mSegmentEnd( 0.0 ),
+      mBound( 0.0 ),
+      mSegment( 0 )
+{
+}
+
+bool RateProfile::load( const std::string &fileName )
+{
+    std::ifstream file( fileName.c_str() );
+    if( !file )
+    {
+        return false;
+    }
+
+    mTimes.clear();
+    mRates.clear();
+    mSwitchRates.clear();
+    mPeriod = 0.0;
+
+    bool haveType = false;
+    std::string line;
+    while( std::getline( file, line ) )
+    {
+        //Strip comments and skip empty lines
+        line = line.substr( 0, line.find( '#' ) );
+        std::istringstream str( line );
+        std::string keyword;
+        if( !( str >> keyword ) )
+        {
+            continue;
+        }
+
+        //First line names the profile type
+        if( !haveType )
+        {
+            if( keyword == "constant" )
+            {
+                mType = EPT_PIECEWISE_CONSTANT;
+            }
+            else if( keyword == "linear" )
+            {
+                mType = EPT_PIECEWISE_LINEAR;
+            }
+            else if( keyword == "mmpp" )
+            {
+                mType = EPT_MMPP;
+            }
+            else
+            {
+                return false;
+            }
+            haveType = true;
+            continue;
+        }
+
+        if( keyword == "period" )
+        {
+            if( !( str >> mPeriod ) || mPeriod <= 0.0 )
+            {
+                return false;
+            }
+            continue;
+        }
+
+        std::istringstream values( line );
+        if( mType == EPT_MMPP )
+        {
+            //<arrival rate> <rate of switching to state 0> ... <to state n-1>
+            double rate, switchRate;
+            if( !( values >> rate ) || rate < 0.0 )
+            {
+                return false;
+            }
+            mRates.push_back( rate );
+            mSwitchRates.push_back( std::vector<double>() );
+            while( values >> switchRate )
+            {
+                if( switchRate < 0.0 )
+                {
+                    return false;
+                }
+                mSwitchRates.back().push_back( switchRate );
+            }
+        }
+        else
+        {
+            //<segment start time> <arrival rate>
+            double time, rate;
+            if( !( values >> time >> rate ) || rate < 0.0
+                    || ( mTimes.empty() && time != 0.0 )
+                    || ( !mTimes.empty() && time <= mTimes.back() ) )
+            {
+                return false;
+            }
+            mTimes.push_back( time );
+            mRates.push_back( rate );
+        }
+    }
+
+    if( mRates.empty() )
+    {
+        return false;
+    }
+
+    if( mType == EPT_MMPP )
+    {
+        for( size_t x = 0; x < mSwitchRates.size(); ++x )
+        {
+            if( mSwitchRates[x].size() != mRates.size() )
+            {
+                return false;
+            }
+
+            //Staying in a state is not a switch
+            mSwitchRates[x][x] = 0.0;
+        }
+    }
+    else if( mPeriod > 0.0 && mPeriod <= mTimes.back() )
+    {
+        return false;
+    }
+
+    mSegmentTimes.assign( getNumSegments(), 0.0 );
+    mStarted = false;
+
+    return true;
+}
+
+RateProfile::E_PROFILE_TYPE RateProfile::getType() const
+{
+    return mType;
+}
+
+size_t RateProfile::getNumSegments() const
+{
+    return mRates.size();
+}
+
+double RateProfile::getSegmentTime( size_t segment ) const
+{
+    return mSegmentTimes[segment];
+}
+
+unsigned int RateProfile::generate( size_t currentTime, unsigned int &segment )
+{
+    if( !mStarted )
+    {
+        //Find the segment containing the start time
+        mTime = currentTime;
+        if( mType == EPT_MMPP )
+        {
+            enterSegment( 0, mTime );
+        }
+        else
+        {
+            mCycleStart = ( mPeriod > 0.0 ) ? std::floor( mTime / mPeriod ) * mPeriod : 0.0;
+            enterSegment( 0, mCycleStart );
+            while( mSegmentEnd <= mTime )
+            {
+                nextSegment();
+            }
+        }
+        mStarted = true;
+    }
+
+    double time = std::max( mTime, (double)currentTime );
+    double infinity = std::numeric_limits<double>::infinity();
+
+    while( true )
+    {
+        //Draw a candidate with the bound of the current segment
+        double next = infinity;
+        if( mBound > 0.0 )
+        {
+            mDistribution.param(
+                        boost::random::exponential_distribution<double>::param_type( mBound ) );
+            next = time + mDistribution( mRandomNumberGenerator );
+        }
+
+        //Candidates beyond the segment are discarded, the exponential
+        //distribution is memoryless so drawing restarts at the segment end
+        if( next >= mSegmentEnd )
+        {
+            if( mSegmentEnd == infinity )
+            {
+                //No more arrivals
+                mTime = time;
+                segment = mSegment;
+                return NO_MORE_ARRIVALS;
+            }
+
+            mSegmentTimes[mSegment] += mSegmentEnd - time;
+            time = mSegmentEnd;
+            nextSegment();
+            continue;
+        }
+
+        mSegmentTimes[mSegment] += next - time;
+        time = next;
+
+        //Only linear segments have a rate below their bound
+        if( mType != EPT_PIECEWISE_LINEAR
+                || mThinningDistribution( mRandomNumberGenerator ) * mBound <= getRate( time ) )
+        {
+            break;
+        }
+    }
+
+    mTime = time;
+    segment = mSegment;
+
+    return std::floor( time ) - (double)currentTime;
+}
+
+void RateProfile::enterSegment( unsigned int segment, double begin )
+{
+    mSegment = segment;
+
+    if( mType == EPT_MMPP )
+    {
+        double switchRate = 0.0;
+        for( double rate : mSwitchRates[segment] )
+        {
+            switchRate += rate;
+        }
+
+        mSegmentEnd = std::numeric_limits<double>::infinity();
+        if( switchRate > 0.0 )
+        {
+            mDistribution.param(
+                        boost::random::exponential_distribution<double>::param_type( switchRate ) );
+            mSegmentEnd = begin + mDistribution( mRandomNumberGenerator );
+        }
+        mBound = mRates[segment];
+        return;
+    }
+
+    if( segment + 1 < mTimes.size() )
+    {
+        mSegmentEnd = mCycleStart + mTimes[segment + 1];
+    }
+    else if( mPeriod > 0.0 )
+    {
+        mSegmentEnd = mCycleStart + mPeriod;
+    }
+    else
+    {
+        mSegmentEnd = std::numeric_limits<double>::infinity();
+    }
+
+    mBound = mRates[segment];
+    if( mType == EPT_PIECEWISE_LINEAR )
+    {
+        mBound = std::max( mBound, getRate( mSegmentEnd ) );
+    }
+}
+
+void RateProfile::nextSegment()
+{
+    if( mType == EPT_MMPP )
+    {
+        enterSegment( generateIndex( mSwitchRates[mSegment] ), mSegmentEnd );
+    }
+    else if( mSegment + 1 < mTimes.size() )
+    {
+        enterSegment( mSegment + 1, mSegmentEnd );
+    }
+    else
+    {
+        mCycleStart += mPeriod;
+        enterSegment( 0, mSegmentEnd );
+    }
+}
+
+double RateProfile::getRate( double time ) const
+{
+    double rate = mRates[mSegment];
+    if( mType != EPT_PIECEWISE_LINEAR )
+    {
+        return rate;
+    }
+
+    //Interpolate towards the next point, the last point leads back to the
+    //first one of the next period
+    double nextTime, nextRate;
+    if( mSegment + 1 < mTimes.size() )
+    {
+        nextTime = mTimes[mSegment + 1];
+        nextRate = mRates[mSegment + 1];
+    }
+    else if( mPeriod > 0.0 )
+    {
+        nextTime = mPeriod;
+        nextRate = mRates[0];
+    }
+    else
+    {
+        return rate;
+    }
+
+    double x = ( time - mCycleStart - mTimes[mSegment] ) / ( nextTime - mTimes[mSegment] );
+    return rate + ( nextRate - rate ) * std::min( std::max( x, 0.0 ), 1.0 );
+}
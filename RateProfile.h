@@ -0,0 +1,80 @@
+/*
+    Copyright 2013 Felix Müller.
+
+    This file is part of VSSim.
+
+    VSSim is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    VSSim is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with VSSim.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef RATEPROFILE_H
+#define RATEPROFILE_H
+
+#include <string>
+#include <vector>
+#include <boost/random/uniform_01.hpp>
+#include "Generator.h"
+
+//Generates arrivals of a non-homogeneous Poisson process. The time axis is
+//split into segments (profile pieces or MMPP state sojourns) and candidates
+//are drawn with the maximal rate of the current segment, then thinned.
+class RateProfile : public Generator
+{
+public:
+    enum E_PROFILE_TYPE
+    {
+        EPT_PIECEWISE_CONSTANT = 0,
+        EPT_PIECEWISE_LINEAR,
+        EPT_MMPP
+    };
+
+    RateProfile();
+
+    bool load( const std::string &fileName );
+
+    E_PROFILE_TYPE getType() const;
+    size_t getNumSegments() const;
+    double getSegmentTime( size_t segment ) const;
+
+    //Returned by generate() when a profile without period has ended with a
+    //rate of 0
+    static const unsigned int NO_MORE_ARRIVALS = 0xffffffffu;
+
+    //Returns the distance from currentTime to the next arrival and the
+    //segment that arrival falls into
+    unsigned int generate( size_t currentTime, unsigned int &segment );
+
+private:
+    void enterSegment( unsigned int segment, double begin );
+    void nextSegment();
+    double getRate( double time ) const;
+
+    E_PROFILE_TYPE mType;
+
+    //Piecewise profiles: rate at the start of each segment, repeated every
+    //mPeriod time units if mPeriod is not 0
+    std::vector<double> mTimes, mRates;
+    double mPeriod;
+
+    //MMPP: arrival rate per state (mRates) and rates of switching between states
+    std::vector<std::vector<double> > mSwitchRates;
+
+    bool mStarted;
+    double mTime, mCycleStart, mSegmentEnd, mBound;
+    unsigned int mSegment;
+    std::vector<double> mSegmentTimes;
+
+    boost::random::uniform_01<double> mThinningDistribution;
+};
+
+#endif // RATEPROFILE_H
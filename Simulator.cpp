@@ -18,7 +18,9 @@
 */
 
 #include "Simulator.h"
+#include "FastPathEngine.h"
 #include <limits>
+#include <algorithm>
 #include <math.h>
 
 Simulator::Simulator( unsigned int incomingRate, unsigned int serviceDuration,
@@ -26,7 +28,11 @@ Simulator::Simulator( unsigned int incomingRate, unsigned int serviceDuration,
     : QThread( parent ),
       mRunning( true ),
       mFirstRun( true ),
-      mDeleteEventAtZero( false )
+      mDeleteEventAtZero( false ),
+      mArrivalsEnded( false ),
+      mNumDownServiceUnits( 0 ),
+      mDownTime( 0 ),
+      mArrivalDerivative( 0.0 )
 {
     mIncomingRateGenerator.setValue( incomingRate );
     mServiceDurationGenerator.setValue( serviceDuration );
@@ -40,39 +46,106 @@ Simulator::~Simulator()
 
 void Simulator::run()
 {
-    size_t nextIncomingTime, nextFinishedTime;
+    //FIFO stations with finite service units do not need the event list
+    if( isFastPathEligible() )
+    {
+        runFastPath();
+    }
+    else
+    {
+        runEventEngine();
+    }
+
+    updateSegmentTimes();
+    emit updateValues( mData );
+    emit finished();
+}
+
+void Simulator::runEventEngine()
+{
+    size_t startTime = 0, lastEventTime;
+
+    //Integrals of N and NQ over time
+    size_t systemTime = 0, queueTime = 0;
+
+    mData.segments.assign( mRateProfile ? mRateProfile->getNumSegments() : 0,
+                           SimulationData::SegmentStatistics() );
+
+    //All service units start idle and working
+    mServiceUnits.assign( std::max( mData.numServiceUnits, 0 ), ServiceUnit() );
+    mIdleServiceUnits.clear();
+    for( int unit = mData.numServiceUnits - 1; unit >= 0; --unit )
+    {
+        releaseServiceUnit( unit );
+    }
+
+    //Derivatives by perturbation analysis assume unchanged sample paths, which
+    //breakdowns, time-varying arrivals and lost requests do not provide
+    mData.enableGradients = mData.enableGradients && !mData.enableBreakdowns
+            && !mRateProfile && mData.capacity == 0;
+
+    //Pre-populate service units and queue if the run should start near steady state
+    if( mData.steadyStateStart )
+    {
+        startTime = initializeSteadyState();
+    }
+    lastEventTime = startTime;
+    mData.simulationTime = startTime;
+    mArrivalDerivative = 0.0;
 
     //Initialize simulation: generate EET_INCOMING event and first EET_MEASURE event
-    nextIncomingTime = mIncomingRateGenerator.generate();
-    mEvents.insert( Event::makeEventPair( Event::EET_INCOMING_EVENT,
-                                          nextIncomingTime, 0 ) );
+    scheduleIncomingEvent();
 
     if( mData.enableMeasureEvents )
     {
         mEvents.insert( Event::makeEventPair( Event::EET_MEASURE_EVENT,
-                                              mData.measureEventDistance, 0 ) );
+                                              startTime + mData.measureEventDistance,
+                                              startTime ) );
+    }
+
+    //Schedule the first breakdown of every service unit
+    if( mData.enableBreakdowns )
+    {
+        for( size_t unit = 0; unit < mServiceUnits.size(); ++unit )
+        {
+            auto failure = Event::makeEventPair( Event::EET_FAILURE_EVENT,
+                                                 startTime + mFailureGenerator.generate(),
+                                                 startTime );
+            failure.second.setServiceUnit( unit, 0 );
+            mEvents.insert( failure );
+        }
     }
 
     while( mRunning )
     {
+        //A profile without any arrivals leaves nothing to simulate
+        if( mEvents.empty() )
+        {
+            mData.stopReason = ESR_END_OF_PROFILE;
+            break;
+        }
+
         //Get next Event's time
-        auto begin = mEvents.begin();
-        while( begin->second.getType() == Event::EET_START_SERVICE_EVENT )
+        mData.simulationTime = mEvents.begin()->first;
+
+        //Record time spent with the current number of requests in system
+        size_t elapsed = mData.simulationTime - lastEventTime;
+        if( mData.occupancy.size() <= (size_t)mData.N.cur )
         {
-            ++begin;
+            mData.occupancy.resize( mData.N.cur + 1, 0 );
         }
-        mData.simulationTime = begin->first;
+        mData.occupancy[mData.N.cur] += elapsed;
+        systemTime += mData.N.cur * elapsed;
+        queueTime += mData.NQ.cur * elapsed;
+        mDownTime += mNumDownServiceUnits * elapsed;
+        lastEventTime = mData.simulationTime;
 
         //Iterate over all events (they are sorted beacuse of std::multimap)
 
         for( auto pair : mEvents )
         {
             //Handle only events at current timestamp
-            if( pair.second.getType() == Event::EET_START_SERVICE_EVENT )
-            {
-                continue;
-            }
-            else if( pair.first != mData.simulationTime ) //later events
+            if( pair.first != mData.simulationTime ) //later events
             {
                 break;
             }
@@ -83,11 +156,24 @@ void Simulator::run()
             {
                 //Generate new incoming event and duration event for current
                 //incoming event
-                nextIncomingTime = mData.simulationTime
-                        + mIncomingRateGenerator.generate();
-                mEvents.insert( Event::makeEventPair( Event::EET_INCOMING_EVENT,
-                                                      nextIncomingTime,
-                                                      mData.simulationTime ) );
+                scheduleIncomingEvent();
+
+                //Statistics per rate segment are kept by segment of arrival
+                unsigned int segment = pair.second.getSegment();
+                if( !mData.segments.empty() )
+                {
+                    mData.segments[segment].requests++;
+                }
+
+                //Requests finding the system full are lost
+                mData.arrivals++;
+                if( mData.capacity > 0 && (size_t)mData.N.cur >= mData.capacity )
+                {
+                    mData.blocked++;
+                    mData.lossProbability = (float)mData.blocked / (float)mData.arrivals;
+                    break;
+                }
+                mData.lossProbability = (float)mData.blocked / (float)mData.arrivals;
 
                 //Increment service unit ussage
                 mData.N.cur++;
@@ -99,9 +185,20 @@ void Simulator::run()
                 mData.T.cur = 0;
                 mData.TQ.cur = 0;
 
+                Event request( Event::EET_START_SERVICE_EVENT, 0, mData.simulationTime,
+                               segment );
+                request.setArrivalDerivative( pair.second.getArrivalDerivative() );
+
+                //Requests arriving while service units are down see degraded mode
+                if( mNumDownServiceUnits > 0 )
+                {
+                    request.setFlags( Event::EEF_DEGRADED );
+                }
+
                 //If there is a finite number of service units, check if they are
-                //busy
-                if( mData.numServiceUnits > 0 && mData.N.cur == mData.numServiceUnits )
+                //all busy
+                int unit = acquireServiceUnit();
+                if( mData.numServiceUnits > 0 && unit < 0 )
                 {
                     //Increment queue usage
                     mData.NQ.cur++;
@@ -109,19 +206,18 @@ void Simulator::run()
                     //Uodate NQ
                     calculateStatistics( mData.NQ );
 
-                    //Create START_SERVICE event to save the creation time
-                    //Use start time of 0 to indicate unknown starting time
-                    mEvents.insert( Event::makeEventPair( Event::EET_START_SERVICE_EVENT,
-                                                          0, mData.simulationTime ) );
+                    //The START_SERVICE event keeps the creation time until
+                    //a service unit takes the request
+                    mQueue.push_back( request );
                 }
                 else
                 {
+                    //Requests served directly have not waited at all
+                    calculateStatistics( mData.TQ );
+                    calculateSegmentStatistics( segment, mData.TQ.cur, false );
+
                     //As the request can be directly serviced, add its finished event
-                    nextFinishedTime = mData.simulationTime
-                            + mServiceDurationGenerator.generate();
-                    mEvents.insert( Event::makeEventPair( Event::EET_FINISHED_EVENT,
-                                                          nextFinishedTime,
-                                                          mData.simulationTime ) );
+                    startService( request, unit, mServiceDurationGenerator.generate() );
                 }
 
                 break;
@@ -129,6 +225,15 @@ void Simulator::run()
 
             case Event::EET_FINISHED_EVENT:
             {
+                //Finished events of interrupted requests are cancelled lazily:
+                //the service unit's generation has moved on since scheduling
+                int unit = pair.second.getServiceUnit();
+                if( unit >= 0
+                        && pair.second.getGeneration() != mServiceUnits[unit].generation )
+                {
+                    break;
+                }
+
                 //Decrement current service unit usage
                 mData.N.cur--;
 
@@ -139,32 +244,28 @@ void Simulator::run()
 
                 //Update T
                 calculateStatistics( mData.T );
+                calculateSegmentStatistics( pair.second.getSegment(), mData.T.cur, true );
 
-                //Check for queued request created at time 0
-                auto it = mEvents.find( 0 );
-                if( it != mEvents.end()
-                        && it->second.getType() == Event::EET_START_SERVICE_EVENT )
+                if( pair.second.getFlags() & Event::EEF_DEGRADED )
                 {
-                    //Decrement queue usage
-                    mData.NQ.cur--;
-
-                    //Uodate NQ
-                    calculateStatistics( mData.NQ );
-
-                    mData.TQ.cur = mData.simulationTime - it->second.getCreationTime();
-
-                    //Update TQ
-                    calculateStatistics( mData.TQ );
+                    mData.TDegraded.cur = mData.T.cur;
+                    calculateStatistics( mData.TDegraded );
+                }
 
-                    //As the request can now be serviced, add its finished event
-                    nextFinishedTime = mData.simulationTime
-                            + mServiceDurationGenerator.generate();
-                    mEvents.insert( Event::makeEventPair( Event::EET_FINISHED_EVENT,
-                                                          nextFinishedTime,
-                                                          it->second.getCreationTime() ) );
+                //T = finish - arrival, the arrival does not depend on the
+                //service duration
+                if( mData.enableGradients && unit >= 0 )
+                {
+                    addGradientSample( mData.dTdService, mServiceUnits[unit].dFinishService );
+                    addGradientSample( mData.dTdRate, mServiceUnits[unit].dFinishRate
+                                       - pair.second.getArrivalDerivative() );
+                }
 
-                    //Delete Event
-                    mEvents.erase( it );
+                //Service unit takes the next queued request, if any
+                if( unit >= 0 )
+                {
+                    mServiceUnits[unit].busy = false;
+                    serveQueue( unit );
                 }
 
                 break;
@@ -172,7 +273,7 @@ void Simulator::run()
 
             case Event::EET_START_SERVICE_EVENT:
             {
-                //THIS SHOULD NEVER HAPPEN! (start time of these events is 0...)
+                //THIS SHOULD NEVER HAPPEN! (queued requests are kept in mQueue)
                 break;
             }
 
@@ -194,6 +295,18 @@ void Simulator::run()
                 break;
             }
 
+            case Event::EET_FAILURE_EVENT:
+            {
+                failServiceUnit( pair.second.getServiceUnit() );
+                break;
+            }
+
+            case Event::EET_REPAIR_EVENT:
+            {
+                repairServiceUnit( pair.second.getServiceUnit() );
+                break;
+            }
+
             default:
                 break;
             }
@@ -202,23 +315,488 @@ void Simulator::run()
         //Delete current events cause they are no longer needed
         mEvents.erase( mData.simulationTime );
 
+        //N and NQ are time averages, as on the fast path; their samples only
+        //feed the precision estimate
+        if( mData.simulationTime > startTime )
+        {
+            float duration = (float)( mData.simulationTime - startTime );
+            mData.N.value = (float)systemTime / duration;
+            mData.NQ.value = (float)queueTime / duration;
+
+            //Includes units that are down right now
+            if( !mServiceUnits.empty() )
+            {
+                mData.availability = 1.f - (float)mDownTime
+                        / ( (float)mServiceUnits.size() * duration );
+            }
+        }
+
         //Check if stop criteria are met
-        if( mData.N.value > 0.f
-                && mData.N.standardDerivation <= mData.minimalSD
-                && mData.T.standardDerivation <= mData.minimalSD )
+        if( stopCriteriaMet() )
+        {
+            mData.stopReason = ESR_PRECISION;
+            mRunning = false;
+        }
+        else if( overloadDetected() )
+        {
+            mData.stopReason = ESR_OVERLOAD;
+            mRunning = false;
+        }
+        else if( memoryBudgetExceeded() )
+        {
+            mData.stopReason = ESR_MEMORY_BUDGET;
+            mRunning = false;
+        }
+        else if( mArrivalsEnded && ( mData.N.cur == 0 || mEvents.empty() ) )
+        {
+            mData.stopReason = ESR_END_OF_PROFILE;
+            mRunning = false;
+        }
+
+        emitRequestedUpdate();
+    }
+}
+
+int Simulator::acquireServiceUnit()
+{
+    //Units that broke down while listed as idle are dropped here
+    while( !mIdleServiceUnits.empty() )
+    {
+        int unit = mIdleServiceUnits.back();
+        mIdleServiceUnits.pop_back();
+        mServiceUnits[unit].idleListed = false;
+
+        if( mServiceUnits[unit].up && !mServiceUnits[unit].busy )
+        {
+            return unit;
+        }
+    }
+
+    return -1;
+}
+
+void Simulator::releaseServiceUnit( int unit )
+{
+    if( !mServiceUnits[unit].idleListed )
+    {
+        mServiceUnits[unit].idleListed = true;
+        mIdleServiceUnits.push_back( unit );
+    }
+}
+
+void Simulator::scheduleIncomingEvent()
+{
+    unsigned int segment;
+    unsigned int distance = generateIncomingDistance( mData.simulationTime, segment );
+
+    //A rate profile may end with a rate of 0
+    if( mRateProfile && distance == RateProfile::NO_MORE_ARRIVALS )
+    {
+        mArrivalsEnded = true;
+        return;
+    }
+    size_t nextIncomingTime = mData.simulationTime + distance;
+
+    //Distance = X / rate, so every distance adds -distance / rate to the
+    //derivative of the arrival time
+    if( mData.enableGradients )
+    {
+        mArrivalDerivative -= mIncomingRateGenerator.getLastSample()
+                * (double)mIncomingRateGenerator.getValue();
+    }
+
+    auto incoming = Event::makeEventPair( Event::EET_INCOMING_EVENT, nextIncomingTime,
+                                          mData.simulationTime, segment );
+    incoming.second.setArrivalDerivative( mArrivalDerivative );
+    mEvents.insert( incoming );
+}
+
+void Simulator::startService( const Event &request, int unit, size_t duration )
+{
+    size_t nextFinishedTime = mData.simulationTime + duration;
+    auto finished = Event::makeEventPair( Event::EET_FINISHED_EVENT, nextFinishedTime,
+                                          request.getCreationTime(), request.getSegment() );
+    finished.second.setFlags( request.getFlags() );
+    finished.second.setArrivalDerivative( request.getArrivalDerivative() );
+
+    if( mData.enableGradients )
+    {
+        //Service starts on arrival or when the unit finished its previous
+        //request, so the start inherits that finish time's derivatives
+        double dStartService = 0.0;
+        double dStartRate = request.getArrivalDerivative();
+        if( unit >= 0 && mData.simulationTime > request.getCreationTime() )
+        {
+            dStartService = mServiceUnits[unit].dFinishService;
+            dStartRate = mServiceUnits[unit].dFinishRate;
+        }
+
+        addGradientSample( mData.dTQdService, dStartService );
+
+        //The duration was just drawn as mean * X, its derivative is X
+        double dDuration = mServiceDurationGenerator.getLastSample()
+                / (double)mServiceDurationGenerator.getValue();
+        if( unit >= 0 )
+        {
+            mServiceUnits[unit].dFinishService = dStartService + dDuration;
+            mServiceUnits[unit].dFinishRate = dStartRate;
+        }
+        else
         {
-            //Only check queue parameters if there is need for a queue
-            if( mData.numServiceUnits == 0
-                    || ( mData.NQ.standardDerivation <= mData.minimalSD
-                    && mData.TQ.standardDerivation <= mData.minimalSD ) )
+            //Without service units T is the duration itself
+            addGradientSample( mData.dTdService, dDuration );
+            addGradientSample( mData.dTdRate, 0.0 );
+        }
+    }
+
+    if( unit >= 0 )
+    {
+        ServiceUnit &serviceUnit = mServiceUnits[unit];
+        serviceUnit.busy = true;
+        serviceUnit.request = request;
+        serviceUnit.duration = duration;
+        serviceUnit.finishTime = nextFinishedTime;
+        finished.second.setServiceUnit( unit, serviceUnit.generation );
+    }
+
+    mEvents.insert( finished );
+}
+
+void Simulator::serveQueue( int unit )
+{
+    if( !mServiceUnits[unit].up )
+    {
+        return;
+    }
+
+    //Check for queued requests
+    if( !mQueue.empty() )
+    {
+        Event request = mQueue.front();
+        mQueue.pop_front();
+
+        //Decrement queue usage
+        mData.NQ.cur--;
+
+        //Uodate NQ
+        calculateStatistics( mData.NQ );
+
+        //Requests put back by a breakdown already counted their waiting time
+        if( !( request.getFlags() & Event::EEF_REQUEUED ) )
+        {
+            mData.TQ.cur = mData.simulationTime - request.getCreationTime();
+
+            //Update TQ
+            calculateStatistics( mData.TQ );
+            calculateSegmentStatistics( request.getSegment(), mData.TQ.cur, false );
+        }
+
+        //As the request can now be serviced, add its finished event
+        startService( request, unit, mServiceDurationGenerator.generate() );
+    }
+    else
+    {
+        releaseServiceUnit( unit );
+    }
+}
+
+void Simulator::addGradientSample( Gradient &gradient, double sample )
+{
+    //Batch means: consecutive requests are correlated, batches much less so.
+    //Batches needed for a confidence interval, more get merged.
+    static const size_t minimalBatches = 16;
+    static const size_t maximalBatches = 64;
+
+    gradient.num++;
+    gradient.sum += sample;
+    gradient.value = gradient.sum / (double)gradient.num;
+
+    gradient.batchSum += sample;
+    if( ++gradient.batchCount < gradient.batchSize )
+    {
+        return;
+    }
+    gradient.batches.push_back( gradient.batchSum );
+    gradient.batchSum = 0.0;
+    gradient.batchCount = 0;
+
+    if( gradient.batches.size() >= maximalBatches )
+    {
+        for( size_t x = 0; x < maximalBatches / 2; ++x )
+        {
+            gradient.batches[x] = gradient.batches[2 * x] + gradient.batches[2 * x + 1];
+        }
+        gradient.batches.resize( maximalBatches / 2 );
+        gradient.batchSize *= 2;
+    }
+
+    if( gradient.batches.size() < minimalBatches )
+    {
+        return;
+    }
+
+    double n = (double)gradient.batches.size();
+    double sum = 0.0, sumSQ = 0.0;
+    for( double batch : gradient.batches )
+    {
+        double batchMean = batch / (double)gradient.batchSize;
+        sum += batchMean;
+        sumSQ += batchMean * batchMean;
+    }
+
+    //2.131 is the t quantile for 15 degrees of freedom, conservative for
+    //more batches
+    double variance = ( sumSQ - sum * sum / n ) / ( n - 1.0 );
+    gradient.halfWidth = 2.131 * std::sqrt( std::max( variance, 0.0 ) / n );
+}
+
+void Simulator::failServiceUnit( int unit )
+{
+    ServiceUnit &serviceUnit = mServiceUnits[unit];
+    serviceUnit.up = false;
+    mNumDownServiceUnits++;
+
+    if( serviceUnit.busy )
+    {
+        //Invalidate the pending finished event without searching for it
+        serviceUnit.generation++;
+
+        switch( mData.interruptPolicy )
+        {
+        case EIP_RESUME:
+            serviceUnit.remainingTime = serviceUnit.finishTime - mData.simulationTime;
+            break;
+
+        case EIP_RESTART:
+            break;
+
+        case EIP_REQUEUE:
+        {
+            serviceUnit.busy = false;
+
+            //Another unit may be idle, otherwise the request goes back to
+            //the head of the queue
+            Event request = serviceUnit.request;
+            request.setFlags( request.getFlags() | Event::EEF_REQUEUED );
+            int otherUnit = acquireServiceUnit();
+            if( otherUnit >= 0 )
+            {
+                startService( request, otherUnit, mServiceDurationGenerator.generate() );
+            }
+            else
             {
-                mRunning = false;
+                mData.NQ.cur++;
+                calculateStatistics( mData.NQ );
+
+                mQueue.push_front( request );
             }
+            break;
+        }
         }
     }
 
-    emitUpdateSignal();
-    emit finished();
+    auto repair = Event::makeEventPair( Event::EET_REPAIR_EVENT,
+                                        mData.simulationTime + mRepairGenerator.generate(),
+                                        mData.simulationTime );
+    repair.second.setServiceUnit( unit, 0 );
+    mEvents.insert( repair );
+}
+
+void Simulator::repairServiceUnit( int unit )
+{
+    ServiceUnit &serviceUnit = mServiceUnits[unit];
+    serviceUnit.up = true;
+    mNumDownServiceUnits--;
+
+    //Continue the interrupted request or repeat its identical service (the
+    //same duration, a fresh one would make restart equal to resume), or take
+    //the next queued one
+    if( serviceUnit.busy )
+    {
+        size_t duration = ( mData.interruptPolicy == EIP_RESUME )
+                ? serviceUnit.remainingTime : serviceUnit.duration;
+        startService( serviceUnit.request, unit, duration );
+    }
+    else
+    {
+        serveQueue( unit );
+    }
+
+    auto failure = Event::makeEventPair( Event::EET_FAILURE_EVENT,
+                                         mData.simulationTime + mFailureGenerator.generate(),
+                                         mData.simulationTime );
+    failure.second.setServiceUnit( unit, 0 );
+    mEvents.insert( failure );
+}
+
+void Simulator::runFastPath()
+{
+    FastPathEngine engine( mIncomingRateGenerator.getValue(),
+                           mServiceDurationGenerator.getValue(),
+                           mData.numServiceUnits );
+    mData.usedFastPath = true;
+
+    while( mRunning )
+    {
+        engine.simulate( 16384 );
+
+        //Pool the replications of all lanes
+        Var T, TQ;
+        size_t time = 0;
+        for( int lane = 0; lane < FastPathEngine::LANES; ++lane )
+        {
+            const FastPathEngine::LaneStatistics &stats = engine.getLaneStatistics( lane );
+            T.num += stats.num;
+            T.sum += stats.sumT;
+            T.sumSQ += stats.sumSQT;
+            TQ.num += stats.num;
+            TQ.sum += stats.sumTQ;
+            TQ.sumSQ += stats.sumSQTQ;
+            time += stats.time;
+        }
+        evaluateStatistics( T );
+        evaluateStatistics( TQ );
+
+        //Time averages N and NQ follow from Little's law: N = (num / time) * T
+        float rate = (float)T.num / (float)std::max( time, (size_t)1 );
+        Var N, NQ;
+        N.num = NQ.num = T.num;
+        N.value = rate * T.value;
+        N.variance = rate * rate * T.variance;
+        N.standardDerivation = rate * T.standardDerivation;
+        NQ.value = rate * TQ.value;
+        NQ.variance = rate * rate * TQ.variance;
+        NQ.standardDerivation = rate * TQ.standardDerivation;
+
+        mData.simulationTime = time / FastPathEngine::LANES;
+        mData.N = N;
+        mData.T = T;
+        mData.NQ = NQ;
+        mData.TQ = TQ;
+
+        if( stopCriteriaMet() )
+        {
+            mData.stopReason = ESR_PRECISION;
+            mRunning = false;
+        }
+
+        emitRequestedUpdate();
+    }
+}
+
+bool Simulator::isFastPathEligible() const
+{
+    if( !mData.enableFastPath || mData.numServiceUnits <= 0 || mData.steadyStateStart
+            || mRateProfile || mData.enableBreakdowns || mData.enableGradients
+            || mData.capacity > 0 )
+    {
+        return false;
+    }
+
+    //The recursion needs a stable station to keep workloads bounded
+    double load = (double)mServiceDurationGenerator.getValue()
+            / (double)mIncomingRateGenerator.getValue();
+    return load < (double)mData.numServiceUnits;
+}
+
+bool Simulator::stopCriteriaMet() const
+{
+    //A handful of samples can show no variation at all, e.g. right after a
+    //steady-state start
+    static const size_t minimalSamples = 1000;
+    if( mData.N.num < minimalSamples || mData.T.num < minimalSamples )
+    {
+        return false;
+    }
+
+    //Gradients are reported with confidence intervals from the same run
+    if( mData.enableGradients
+            && ( mData.dTdService.halfWidth == std::numeric_limits<double>::infinity()
+                 || mData.dTQdService.halfWidth == std::numeric_limits<double>::infinity()
+                 || mData.dTdRate.halfWidth == std::numeric_limits<double>::infinity() ) )
+    {
+        return false;
+    }
+
+    if( mData.N.value > 0.f
+            && mData.N.standardDerivation <= mData.minimalSD
+            && mData.T.standardDerivation <= mData.minimalSD )
+    {
+        //Only check queue parameters if there is need for a queue
+        return mData.numServiceUnits == 0
+                || ( mData.NQ.standardDerivation <= mData.minimalSD
+                && mData.TQ.standardDerivation <= mData.minimalSD );
+    }
+
+    return false;
+}
+
+bool Simulator::overloadDetected()
+{
+    //Windows needed before deciding, more get merged to keep memory bounded
+    static const size_t minimalWindows = 20;
+    static const size_t maximalWindows = 64;
+
+    //A finite capacity or unlimited service units keep the queue bounded
+    OverloadDetector &detector = mOverloadDetector;
+    if( !mData.enableOverloadDetection || mData.capacity > 0 || mData.numServiceUnits <= 0
+            || mData.arrivals < detector.arrivals + detector.windowSize )
+    {
+        return false;
+    }
+
+    detector.growth.push_back( mData.N.cur - detector.startN );
+    detector.duration.push_back( mData.simulationTime - detector.startTime );
+    detector.arrivals = mData.arrivals;
+    detector.startTime = mData.simulationTime;
+    detector.startN = mData.N.cur;
+
+    if( detector.growth.size() >= maximalWindows )
+    {
+        for( size_t x = 0; x < maximalWindows / 2; ++x )
+        {
+            detector.growth[x] = detector.growth[2 * x] + detector.growth[2 * x + 1];
+            detector.duration[x] = detector.duration[2 * x] + detector.duration[2 * x + 1];
+        }
+        detector.growth.resize( maximalWindows / 2 );
+        detector.duration.resize( maximalWindows / 2 );
+        detector.windowSize *= 2;
+    }
+
+    if( detector.growth.size() < minimalWindows )
+    {
+        return false;
+    }
+
+    //The first half of the windows covers the warm-up from the initial state
+    size_t first = detector.growth.size() / 2;
+    double n = (double)( detector.growth.size() - first );
+    double sum = 0.0, sumSQ = 0.0, time = 0.0;
+    for( size_t x = first; x < detector.growth.size(); ++x )
+    {
+        sum += detector.growth[x];
+        sumSQ += (double)detector.growth[x] * (double)detector.growth[x];
+        time += detector.duration[x];
+    }
+    mData.queueGrowth = sum / std::max( time, 1.0 );
+
+    //Growth is significant if the lower bound of its one-sided 99% confidence
+    //interval is positive (2.821 is the t quantile for 9 degrees of freedom,
+    //conservative for more windows). Increments of a stable queue cancel
+    //out, which makes the test only more conservative for those.
+    double mean = sum / n;
+    double variance = std::max( 0.0, ( sumSQ - sum * sum / n ) / ( n - 1.0 ) );
+    return mean - 2.821 * std::sqrt( variance / n ) > 0.0;
+}
+
+bool Simulator::memoryBudgetExceeded()
+{
+    //Nodes of the event list hold three pointers and a color besides the pair
+    mData.memoryUsage = mQueue.size() * sizeof( Event )
+            + mEvents.size() * ( sizeof( EventMap::value_type ) + 4 * sizeof( void * ) )
+            + mData.occupancy.capacity() * sizeof( size_t );
+
+    return mData.memoryBudget > 0 && mData.memoryUsage > mData.memoryBudget;
 }
 
 bool Simulator::isRunning()
@@ -242,9 +820,124 @@ void Simulator::setPrecision( float precision )
     mData.minimalSD = precision;
 }
 
+void Simulator::configureSteadyStateStart( bool enabled )
+{
+    mData.steadyStateStart = enabled;
+}
+
+void Simulator::setInitialDistribution( const std::vector<double> &distribution )
+{
+    mInitialDistribution = distribution;
+}
+
+bool Simulator::loadRateProfile( const std::string &fileName )
+{
+    if( fileName.empty() )
+    {
+        mRateProfile.reset();
+        return true;
+    }
+
+    mRateProfile.reset( new RateProfile() );
+    if( !mRateProfile->load( fileName ) )
+    {
+        mRateProfile.reset();
+        return false;
+    }
+
+    return true;
+}
+
+void Simulator::configureBreakdowns( bool enabled,
+                                     unsigned int failureDistance,
+                                     Generator::E_DISTRIBUTION_TYPE failureDistribution,
+                                     unsigned int repairDuration,
+                                     Generator::E_DISTRIBUTION_TYPE repairDistribution,
+                                     E_INTERRUPT_POLICY policy )
+{
+    mData.enableBreakdowns = enabled && mData.numServiceUnits > 0;
+    mData.interruptPolicy = policy;
+
+    mFailureGenerator.setDistribution( failureDistribution );
+    mFailureGenerator.setValue( failureDistance );
+    mRepairGenerator.setDistribution( repairDistribution );
+    mRepairGenerator.setValue( repairDuration );
+}
+
+void Simulator::configureGradients( bool enabled )
+{
+    mData.enableGradients = enabled;
+}
+
+void Simulator::configureFastPath( bool enabled )
+{
+    mData.enableFastPath = enabled;
+}
+
+void Simulator::configureCapacity( unsigned int capacity )
+{
+    mData.capacity = capacity;
+}
+
+void Simulator::configureOverloadDetection( bool enabled )
+{
+    mData.enableOverloadDetection = enabled;
+}
+
+void Simulator::configureMemoryBudget( size_t bytes )
+{
+    mData.memoryBudget = bytes;
+}
+
 void Simulator::emitUpdateSignal()
 {
-    emit updateValues( mData );
+    //Called in the GUI thread, mData may only be read by the simulation
+    //thread while it runs
+    mUpdateRequested.fetchAndStoreOrdered( 1 );
+}
+
+void Simulator::emitRequestedUpdate()
+{
+    //Emitted from the simulation thread, the queued connection copies mData
+    //between two events
+    if( mUpdateRequested.fetchAndStoreOrdered( 0 ) )
+    {
+        updateSegmentTimes();
+        emit updateValues( mData );
+    }
+}
+
+unsigned int Simulator::generateIncomingDistance( size_t currentTime, unsigned int &segment )
+{
+    if( !mRateProfile )
+    {
+        segment = 0;
+        return mIncomingRateGenerator.generate();
+    }
+
+    return mRateProfile->generate( currentTime, segment );
+}
+
+void Simulator::updateSegmentTimes()
+{
+    //Time covered by the profile so far, for the observed rate per segment;
+    //only needed when the data is emitted
+    for( size_t x = 0; x < mData.segments.size(); ++x )
+    {
+        mData.segments[x].time = mRateProfile->getSegmentTime( x );
+    }
+}
+
+void Simulator::calculateSegmentStatistics( unsigned int segment, int value, bool isT )
+{
+    if( mData.segments.empty() )
+    {
+        return;
+    }
+
+    Var &var = isT ? mData.segments[segment].T : mData.segments[segment].TQ;
+    var.cur = value;
+    calculateStatistics( var );
 }
 
 void Simulator::calculateStatistics( Simulator::Var &var )
@@ -252,21 +945,209 @@ void Simulator::calculateStatistics( Simulator::Var &var )
     var.num++;
     var.sum += var.cur;
     var.sumSQ += var.cur * var.cur;
+    evaluateStatistics( var );
+}
+
+void Simulator::evaluateStatistics( Simulator::Var &var )
+{
     var.value = (float)var.sum / (float)var.num;
     var.variance = ( ( (float)var.sumSQ / (float)var.num )
                      - ( var.value * var.value ) );
     var.standardDerivation = std::sqrt( std::abs( var.variance ) ) / (float)var.num;
 }
 
+std::vector<double> Simulator::stationaryDistribution() const
+{
+    std::vector<double> distribution;
+
+    //Time-varying arrivals and breakdowns have no analytic distribution here
+    if( mRateProfile || mData.enableBreakdowns )
+    {
+        return distribution;
+    }
+
+    double A = 1.0 / mIncomingRateGenerator.getMean();
+    double B = 1.0 / mServiceDurationGenerator.getMean();
+    double load = A / B;
+
+    //M/M/c has no stationary distribution if the service units are overloaded,
+    //unless the capacity limits the queue
+    if( mData.numServiceUnits > 0 && mData.capacity == 0
+            && load >= (double)mData.numServiceUnits )
+    {
+        return distribution;
+    }
+
+    //Unnormalized M/M/c probabilities: p(n) = p(n - 1) * load / min(n, c),
+    //with c = oo giving the Poisson distribution of M/M/oo
+    double p = 1.0, sum = 0.0;
+    for( int n = 0; n < 1000000; ++n )
+    {
+        if( n > 0 )
+        {
+            int busyUnits = ( mData.numServiceUnits > 0 )
+                    ? std::min( n, mData.numServiceUnits ) : n;
+            p *= load / (double)busyUnits;
+        }
+
+        distribution.push_back( p );
+        sum += p;
+
+        //Weights of an overloaded M/M/c/K grow geometrically, keep them finite
+        if( p > 1.e100 )
+        {
+            for( double &weight : distribution )
+            {
+                weight *= 1.e-100;
+            }
+            p *= 1.e-100;
+            sum *= 1.e-100;
+        }
+
+        //M/M/c/K: no more than K requests
+        if( mData.capacity > 0 && (size_t)n >= mData.capacity )
+        {
+            break;
+        }
+
+        //Cut off the tail once it is negligible
+        if( ( mData.numServiceUnits == 0 || n >= mData.numServiceUnits )
+                && n >= load && p < sum * 1.e-12 )
+        {
+            break;
+        }
+    }
+
+    return distribution;
+}
+
+size_t Simulator::initializeSteadyState()
+{
+    //Prefer an estimate from a previous run, fall back to the analytic solution
+    std::vector<double> distribution = mInitialDistribution.empty()
+            ? stationaryDistribution() : mInitialDistribution;
+
+    //A distribution without any weight can't be sampled, start empty then
+    double totalWeight = 0.0;
+    for( double weight : distribution )
+    {
+        totalWeight += weight;
+    }
+    if( distribution.empty() || !( totalWeight > 0.0 )
+            || totalWeight == std::numeric_limits<double>::infinity() )
+    {
+        return 0;
+    }
+
+    int numRequests = mIncomingRateGenerator.generateIndex( distribution );
+    int numBusy = ( mData.numServiceUnits > 0 )
+            ? std::min( numRequests, mData.numServiceUnits ) : numRequests;
+    int numQueued = numRequests - numBusy;
+
+    //Arrival distances of queued requests determine how long ago each of
+    //them was created. Requests in service arrived before all queued ones
+    //(FIFO), their age is the oldest queued age plus their elapsed service.
+    std::vector<size_t> busyAges, queuedAges;
+    size_t age = 0, startTime = 0;
+
+    for( int x = 0; x < numQueued; ++x )
+    {
+        age += mIncomingRateGenerator.generate();
+        queuedAges.push_back( age );
+    }
+
+    for( int x = 0; x < numBusy; ++x )
+    {
+        busyAges.push_back( age + mServiceDurationGenerator.generate() );
+        startTime = std::max( startTime, busyAges.back() );
+    }
+    startTime = std::max( startTime, age ) + 1;
+
+    //Busy units get the residual service time of their request (exponential
+    //service is memoryless, so it is a fresh sample)
+    mData.simulationTime = startTime;
+    for( size_t ageBusy : busyAges )
+    {
+        Event request( Event::EET_START_SERVICE_EVENT, 0, startTime - ageBusy );
+        startService( request, acquireServiceUnit(), mServiceDurationGenerator.generate() );
+    }
+
+    //Queued requests, oldest first to keep the queue in arrival order
+    for( auto it = queuedAges.rbegin(); it != queuedAges.rend(); ++it )
+    {
+        mQueue.push_back( Event( Event::EET_START_SERVICE_EVENT, 0, startTime - *it ) );
+    }
+
+    mData.N.cur = numRequests;
+    mData.NQ.cur = numQueued;
+
+    return startTime;
+}
+
 Simulator::SimulationData::SimulationData()
     : simulationTime( 0 ),
       nextEventTime( 0 ),
       minimalSD( 1.e-3f ),
       enableMeasureEvents( true ),
-      measureEventDistance( 100 )
+      measureEventDistance( 100 ),
+      steadyStateStart( false ),
+      enableFastPath( true ),
+      usedFastPath( false ),
+      enableBreakdowns( false ),
+      interruptPolicy( EIP_RESUME ),
+      availability( 1.f ),
+      enableGradients( false ),
+      capacity( 0 ),
+      arrivals( 0 ),
+      blocked( 0 ),
+      lossProbability( 0.f ),
+      stopReason( ESR_NONE ),
+      enableOverloadDetection( true ),
+      queueGrowth( 0.0 ),
+      memoryUsage( 0 ),
+      memoryBudget( 0 )
+{
+}
+
+Simulator::Gradient::Gradient()
+    : value( 0.0 ),
+      halfWidth( std::numeric_limits<double>::infinity() ),
+      sum( 0.0 ),
+      batchSum( 0.0 ),
+      num( 0 ),
+      batchSize( 16 ),
+      batchCount( 0 )
+{
+}
+
+Simulator::OverloadDetector::OverloadDetector()
+    : windowSize( 1000 ),
+      arrivals( 0 ),
+      startTime( 0 ),
+      startN( 0 )
 {
 }
 
+Simulator::ServiceUnit::ServiceUnit()
+    : busy( false ),
+      up( true ),
+      idleListed( false ),
+      generation( 0 ),
+      request( Event::EET_START_SERVICE_EVENT, 0, 0 ),
+      duration( 0 ),
+      finishTime( 0 ),
+      remainingTime( 0 ),
+      dFinishService( 0.0 ),
+      dFinishRate( 0.0 )
+{
+}
+
+
+Simulator::SimulationData::SegmentStatistics::SegmentStatistics()
+    : requests( 0 ),
+      time( 0.0 )
+{
+}
 
 Simulator::Var::Var()
     : value( 0.f ),
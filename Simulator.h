@@ -22,8 +22,14 @@
 
 #include <QThread>
 #include <QTimer>
+#include <QScopedPointer>
+#include <QAtomicInt>
 #include <map>
+#include <deque>
+#include <vector>
+#include <string>
 #include "Generator.h"
+#include "RateProfile.h"
 #include "Event.h"
 
 typedef std::multimap<size_t, Event> EventMap;
@@ -32,6 +38,24 @@ class Simulator : public QThread
 {
     Q_OBJECT
 public:
+    //What happens to a request in service when its service unit breaks down
+    enum E_INTERRUPT_POLICY
+    {
+        EIP_RESUME = 0,     //Continue the remaining service after the repair
+        EIP_RESTART,        //Start the service over after the repair
+        EIP_REQUEUE         //Put the request back at the head of the queue
+    };
+
+    //Why a run ended on its own
+    enum E_STOP_REASON
+    {
+        ESR_NONE = 0,       //Still running or stopped by the user
+        ESR_PRECISION,      //All statistics reached the requested precision
+        ESR_OVERLOAD,       //The queue keeps growing, the run can't converge
+        ESR_MEMORY_BUDGET,  //Queue and event list outgrew the memory budget
+        ESR_END_OF_PROFILE  //The rate profile ended and all requests left
+    };
+
     struct Var
     {
         Var();
@@ -40,8 +64,29 @@ public:
         int cur;
     };
 
+    //Derivative estimated by perturbation analysis, with the half width of
+    //its 95% confidence interval from batch means. The batches grow with the
+    //run, pairs of them are merged once there are too many.
+    struct Gradient
+    {
+        Gradient();
+        double value, halfWidth;
+        double sum, batchSum;
+        size_t num, batchSize, batchCount;
+        std::vector<double> batches;
+    };
+
     struct SimulationData
     {
+        //Statistics of requests arriving in one segment of the rate profile
+        struct SegmentStatistics
+        {
+            SegmentStatistics();
+            Var T, TQ;
+            size_t requests;
+            double time;
+        };
+
         SimulationData();
         size_t simulationTime, nextEventTime;
         int numServiceUnits;
@@ -49,6 +94,43 @@ public:
         Var N, T, NQ, TQ;
         bool enableMeasureEvents;
         unsigned int measureEventDistance;
+        bool steadyStateStart;
+        bool enableFastPath, usedFastPath;
+
+        //Time spent with n requests in the system, indexed by n
+        std::vector<size_t> occupancy;
+
+        std::vector<SegmentStatistics> segments;
+
+        bool enableBreakdowns;
+        E_INTERRUPT_POLICY interruptPolicy;
+
+        //Fraction of time service units were working and T of requests that
+        //arrived while at least one unit was down
+        float availability;
+        Var TDegraded;
+
+        //Derivatives with respect to the average service duration and the
+        //arrival rate (1 / average distance of incoming requests)
+        bool enableGradients;
+        Gradient dTdService, dTQdService, dTdRate;
+
+        //Maximal number of requests in the system (M/M/c/K), 0 for no limit.
+        //Arrivals finding the system full are lost.
+        unsigned int capacity;
+        size_t arrivals, blocked;
+        float lossProbability;
+
+        E_STOP_REASON stopReason;
+
+        //Growth of the queue in requests per time unit, as estimated by the
+        //overload detector
+        bool enableOverloadDetection;
+        double queueGrowth;
+
+        //Bytes held by queue, event list and occupancy histogram, the run
+        //stops when they exceed the budget (0 for no limit)
+        size_t memoryUsage, memoryBudget;
     };
 
     explicit Simulator( unsigned int incomingRate, unsigned int serviceDuration,
@@ -61,21 +143,101 @@ public:
     void quit();
     void configureMeasureEvents( bool enabled, unsigned int distance );
     void setPrecision( float precision );
+    void configureSteadyStateStart( bool enabled );
+    void setInitialDistribution( const std::vector<double> &distribution );
+    void configureBreakdowns( bool enabled,
+                              unsigned int failureDistance,
+                              Generator::E_DISTRIBUTION_TYPE failureDistribution,
+                              unsigned int repairDuration,
+                              Generator::E_DISTRIBUTION_TYPE repairDistribution,
+                              E_INTERRUPT_POLICY policy );
+    void configureGradients( bool enabled );
+    void configureFastPath( bool enabled );
+    void configureCapacity( unsigned int capacity );
+    void configureOverloadDetection( bool enabled );
+    void configureMemoryBudget( size_t bytes );
+    bool loadRateProfile( const std::string &fileName );
 
 signals:
     void finished();
     void updateValues( const Simulator::SimulationData &data );
 
 private:
+    struct ServiceUnit
+    {
+        ServiceUnit();
+        bool busy, up, idleListed;
+
+        //Incremented whenever the pending finished event becomes invalid
+        unsigned int generation;
+
+        //Request currently held by the unit and its drawn service duration,
+        //repeated in full by EIP_RESTART
+        Event request;
+        size_t duration, finishTime, remainingTime;
+
+        //Derivatives of the finish time of the unit's last request
+        double dFinishService, dFinishRate;
+    };
+
+    //Growth of N over windows of equally many arrivals
+    struct OverloadDetector
+    {
+        OverloadDetector();
+        size_t windowSize, arrivals, startTime;
+        int startN;
+        std::vector<int> growth;
+        std::vector<size_t> duration;
+    };
+
+    void runEventEngine();
+    int acquireServiceUnit();
+    void releaseServiceUnit( int unit );
+    void scheduleIncomingEvent();
+    void startService( const Event &request, int unit, size_t duration );
+    void serveQueue( int unit );
+    void failServiceUnit( int unit );
+    void repairServiceUnit( int unit );
+    void addGradientSample( Gradient &gradient, double sample );
+    bool overloadDetected();
+    bool memoryBudgetExceeded();
+    void runFastPath();
+    bool isFastPathEligible() const;
+    bool stopCriteriaMet() const;
+    unsigned int generateIncomingDistance( size_t currentTime, unsigned int &segment );
+    void calculateSegmentStatistics( unsigned int segment, int value, bool isT );
+    void updateSegmentTimes();
     void calculateStatistics( Var &var );
+    void evaluateStatistics( Var &var );
+    std::vector<double> stationaryDistribution() const;
+    size_t initializeSteadyState();
+    void emitRequestedUpdate();
 
     Generator mIncomingRateGenerator, mServiceDurationGenerator;
-    bool mRunning, mFirstRun, mDeleteEventAtZero;
+    QScopedPointer<RateProfile> mRateProfile;
+    Generator mFailureGenerator, mRepairGenerator;
+    bool mRunning, mFirstRun, mDeleteEventAtZero, mArrivalsEnded;
+
+    //Set by the timer in the GUI thread, the simulation thread emits
+    QAtomicInt mUpdateRequested;
 
     SimulationData mData;
 
     EventMap mEvents;
 
+    //Requests waiting for a service unit, in order of service
+    std::deque<Event> mQueue;
+
+    OverloadDetector mOverloadDetector;
+
+    std::vector<double> mInitialDistribution;
+
+    std::vector<ServiceUnit> mServiceUnits;
+    std::vector<int> mIdleServiceUnits;
+    int mNumDownServiceUnits;
+    size_t mDownTime;
+    double mArrivalDerivative;
+
 private slots:
     void emitUpdateSignal();
 
@@ -6,7 +6,7 @@
 
 QT       += core gui
 
-greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets concurrent
 
 TARGET = VS-Projekt
 TEMPLATE = app
@@ -16,13 +16,22 @@ SOURCES += main.cpp\
         MainWindow.cpp \
     Generator.cpp \
     Simulator.cpp \
-    Event.cpp
+    Event.cpp \
+    FastPathEngine.cpp \
+    RateProfile.cpp \
+    CapacityOptimizer.cpp
 
 HEADERS  += MainWindow.h \
     Generator.h \
     Simulator.h \
-    Event.h
+    Event.h \
+    FastPathEngine.h \
+    RateProfile.h \
+    CapacityOptimizer.h
 
 FORMS    += MainWindow.ui
 
 QMAKE_CXXFLAGS += -std=gnu++0x
+
+# The fast path engine uses AVX2/AVX-512 lanes when built for such CPUs, e.g.
+# QMAKE_CXXFLAGS += -march=native